@@ -0,0 +1,52 @@
+#include "axis_scale.h"
+
+void axis_scale_init(axis_scale_t *s, int32_t in_from, int32_t in_to, int32_t out_min, int32_t out_max)
+{
+  s->reversed = in_from > in_to;
+  s->in_min = s->reversed ? in_to : in_from;
+  s->in_max = s->reversed ? in_from : in_to;
+  s->out_min = out_min;
+  s->out_max = out_max > out_min ? out_max : out_min;
+
+  const uint64_t in_range = (uint64_t)((int64_t)s->in_max - s->in_min);
+  const uint64_t out_range = out_max > out_min ? (uint64_t)((int64_t)out_max - out_min) : 0;
+
+  if (in_range == 0 || out_range == 0)
+  {
+    s->multiplier = 0;
+    s->shift = 0;
+    return;
+  }
+
+  // runs once per range, the 64 bit division is fine here
+  for (int shift = 31; shift >= 0; --shift)
+  {
+    const uint64_t multiplier = ((out_range << shift) + in_range / 2) / in_range;
+    const uint64_t half = shift ? 1ull << (shift - 1) : 0;
+    if (in_range * multiplier + half <= UINT32_MAX)
+    {
+      s->multiplier = (uint32_t)multiplier;
+      s->shift = (uint8_t)shift;
+      return;
+    }
+  }
+
+  // output range wider than 32 bits can express
+  s->multiplier = 0;
+  s->shift = 0;
+}
+
+void axis_shape_init(axis_shape_t *s, uint16_t deadzone_center, uint16_t deadzone_edge, const uint16_t *curve)
+{
+  s->identity = deadzone_center == 0 && deadzone_edge == 0;
+
+  for (int i = 0; i < AXIS_SHAPE_POINTS; ++i)
+  {
+    const uint16_t linear = (uint16_t)(i << AXIS_SHAPE_SEGMENT_SHIFT);
+    s->curve[i] = curve ? curve[i] : linear;
+    if (s->curve[i] != linear)
+      s->identity = false;
+  }
+
+  axis_scale_init(&s->deadzone, deadzone_center, AXIS_SHAPE_ONE - deadzone_edge, 0, AXIS_SHAPE_ONE);
+}
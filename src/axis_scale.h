@@ -0,0 +1,105 @@
+#ifndef _tmext_axis_scale_h
+#define _tmext_axis_scale_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+  // Linear range mapping with a multiplier and shift worked out once per range,
+  // applying it is a clamp, one 32 bit multiply and a shift. The M0+ has no FPU
+  // and no 64 bit multiply instruction. A multiplier of 0 means the range cannot
+  // be mapped, e.g. an input span too wide for 32 bits.
+  typedef struct
+  {
+    int32_t in_min;
+    int32_t in_max;
+    int32_t out_min;
+    int32_t out_max;
+    uint32_t multiplier; // (out range / in range) << shift, rounded
+    uint8_t shift;       // largest that keeps in range * multiplier in 32 bits
+    bool reversed;       // in_min maps to out_max
+  } axis_scale_t;
+
+  /**
+   * @brief set up the mapping of in_from - in_to onto out_min - out_max
+   *
+   * in_from may be larger than in_to for a reversed axis. Results are rounded to nearest
+   * and are within 1 of the exact value for ranges up to 16 bits.
+   */
+  void axis_scale_init(axis_scale_t *s, int32_t in_from, int32_t in_to, int32_t out_min, int32_t out_max);
+
+  // map value, inputs outside the range are clamped
+  static inline int32_t axis_scale_apply(const axis_scale_t *s, int32_t value)
+  {
+    if (value < s->in_min)
+      value = s->in_min;
+    if (value > s->in_max)
+      value = s->in_max;
+
+    // unsigned, a span above INT32_MAX must not overflow
+    const uint32_t d = s->reversed ? (uint32_t)s->in_max - (uint32_t)value : (uint32_t)value - (uint32_t)s->in_min;
+    const uint32_t half = s->shift ? 1u << (s->shift - 1) : 0;
+    // a rounded up multiplier can carry wide input spans one past the end
+    const int32_t out = s->out_min + (int32_t)((d * s->multiplier + half) >> s->shift);
+    return out > s->out_max ? s->out_max : out;
+  }
+
+  // Deadzones and response curve, symmetric around the center of the report range.
+  // Works on the deflection from center in units of AXIS_SHAPE_ONE, the curve is
+  // interpolated linearly between AXIS_SHAPE_POINTS evenly spaced points.
+#define AXIS_SHAPE_ONE 32768
+#define AXIS_SHAPE_POINTS 9 // AXIS_SHAPE_ONE / (AXIS_SHAPE_POINTS - 1) is a power of two
+#define AXIS_SHAPE_SEGMENT_SHIFT 12
+
+  typedef struct
+  {
+    bool identity;         // no deadzone and a linear curve, values pass unchanged
+    axis_scale_t deadzone; // deflection with the deadzones cut off, back to 0 - AXIS_SHAPE_ONE
+    uint16_t curve[AXIS_SHAPE_POINTS];
+  } axis_shape_t;
+
+  /**
+   * @brief set up deadzones and curve, center + edge must be below AXIS_SHAPE_ONE
+   *
+   * @param curve : response at 0, 1/8 ... 8/8 deflection, non decreasing, NULL for linear
+   */
+  void axis_shape_init(axis_shape_t *s, uint16_t deadzone_center, uint16_t deadzone_edge, const uint16_t *curve);
+
+  // shape a value of the report range 0 - 2^bits - 1, bits is 8 to 16
+  static inline int32_t axis_shape_apply(const axis_shape_t *s, int32_t value, int bits)
+  {
+    if (s->identity)
+      return value;
+
+    const int32_t half = 1 << (bits - 1);
+    const int32_t offset = value - half;
+    // the upper side is one value short of the lower one, only its last value is full deflection
+    uint32_t deflection = value >= 2 * half - 1 ? AXIS_SHAPE_ONE : (uint32_t)(offset < 0 ? -offset : offset) << (16 - bits);
+
+    deflection = (uint32_t)axis_scale_apply(&s->deadzone, (int32_t)deflection);
+    const uint32_t segment = deflection >> AXIS_SHAPE_SEGMENT_SHIFT;
+    if (segment >= AXIS_SHAPE_POINTS - 1)
+    {
+      deflection = s->curve[AXIS_SHAPE_POINTS - 1];
+    }
+    else
+    {
+      const uint32_t fraction = deflection & ((1u << AXIS_SHAPE_SEGMENT_SHIFT) - 1);
+      const uint32_t rise = (uint32_t)(s->curve[segment + 1] - s->curve[segment]);
+      const uint32_t round = 1u << (AXIS_SHAPE_SEGMENT_SHIFT - 1);
+      deflection = s->curve[segment] + ((rise * fraction + round) >> AXIS_SHAPE_SEGMENT_SHIFT);
+    }
+    deflection >>= 16 - bits;
+
+    const int32_t shaped = offset < 0 ? half - (int32_t)deflection : half + (int32_t)deflection;
+    return shaped > 2 * half - 1 ? 2 * half - 1 : shaped;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_axis_scale_h */
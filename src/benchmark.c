@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "hardware/structs/systick.h"
+#include "benchmark.h"
+#include "axis_scale.h"
+#include "usb_descriptors.h"
+
+#define BENCHMARK_ROUNDS 1000
+#define SYSTICK_MASK 0x00ffffffu
+
+// inputs are volatile so the compiler cannot fold the work into constants
+static volatile int32_t _inputs[4] = {12345, 54321, 1234, 4000};
+static volatile uint32_t _sink;
+
+// the display mapping before axis_scale, kept here as the baseline
+static uint16_t map_range_double(uint16_t input, uint16_t input_start, uint16_t input_end, uint16_t output_start, uint16_t output_end)
+{
+  double slope = 1.0 * (output_end - output_start) / (input_end - input_start);
+  return (uint16_t)round(output_start + slope * (input - input_start));
+}
+
+static void legacy_axes(void)
+{
+  uint8_t out[8];
+  buildAndSetAxisValue(_inputs[0], 0, 65535, &out[0]);
+  buildAndSetAxisValue(_inputs[1], 0, 65535, &out[2]);
+  buildAndSetAxisValue(_inputs[2], 0, 4095, &out[4]);
+  buildAndSetAxisValue(_inputs[3], 0, 4095, &out[6]);
+  _sink = out[1] ^ out[3] ^ out[5] ^ out[7];
+}
+
+static axis_scale_t _report_scales[4];
+
+static void fixed_axes(void)
+{
+  uint8_t out[8];
+  for (int i = 0; i < 4; ++i)
+  {
+    uint32_t v = (uint32_t)axis_scale_apply(&_report_scales[i], _inputs[i]);
+    out[2 * i] = (uint8_t)v;
+    out[2 * i + 1] = (uint8_t)(v >> 8);
+  }
+  _sink = out[1] ^ out[3] ^ out[5] ^ out[7];
+}
+
+static void full_report(void)
+{
+  tm_joystick_report report;
+  tm_joystick_fill_report(&report);
+  _sink = report.x[1];
+}
+
+static void legacy_display(void)
+{
+  _sink = map_range_double(_inputs[0], 0, 65535, 0, 63) + map_range_double(_inputs[1], 0, 65535, 0, 63) +
+          map_range_double(_inputs[2] >> 2, 0, 1023, 0, 63);
+}
+
+static axis_scale_t _stick_scale;
+static axis_scale_t _rudder_scale;
+
+static void fixed_display(void)
+{
+  _sink = axis_scale_apply(&_stick_scale, _inputs[0]) + axis_scale_apply(&_stick_scale, _inputs[1]) +
+          axis_scale_apply(&_rudder_scale, _inputs[2]);
+}
+
+// cycles of one call, averaged, loop overhead included
+static unsigned long cycles(void (*fn)(void))
+{
+  uint32_t start = systick_hw->cvr;
+  for (int i = 0; i < BENCHMARK_ROUNDS; ++i)
+    fn();
+  // SysTick counts down, a round stays far below the 24 bit period
+  return ((start - systick_hw->cvr) & SYSTICK_MASK) / BENCHMARK_ROUNDS;
+}
+
+void benchmark_run(void)
+{
+  axis_scale_init(&_report_scales[0], 0, 65535, 0, 65535);
+  axis_scale_init(&_report_scales[1], 0, 65535, 0, 65535);
+  axis_scale_init(&_report_scales[2], 0, 4095, 0, 65535);
+  axis_scale_init(&_report_scales[3], 0, 4095, 0, 65535);
+  axis_scale_init(&_stick_scale, 0, 65535, 0, 63);
+  axis_scale_init(&_rudder_scale, 0, 4095, 0, 63);
+
+  systick_hw->csr = 0;
+  systick_hw->rvr = SYSTICK_MASK;
+  systick_hw->cvr = 0;
+  systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+
+  printf("benchmark, cycles per call\n");
+  printf("  report axes   map(): %lu  axis_scale: %lu\n", cycles(legacy_axes), cycles(fixed_axes));
+  printf("  display cursors double: %lu  axis_scale: %lu\n", cycles(legacy_display), cycles(fixed_display));
+  printf("  tm_joystick_fill_report: %lu\n", cycles(full_report));
+}
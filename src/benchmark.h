@@ -0,0 +1,23 @@
+#ifndef _tmext_benchmark_h
+#define _tmext_benchmark_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+  /**
+   * @brief time the axis scaling of the report and display paths and printf the cycles
+   *
+   * Compares the fixed point axis_scale with the former map() and double map_range code,
+   * run once at boot with TM_BENCHMARK, after tm_joystick_setup and before USB starts.
+   */
+  void benchmark_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_benchmark_h */
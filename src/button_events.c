@@ -0,0 +1,133 @@
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "button_events.h"
+#include "trace.h"
+
+#define QUEUE_MASK (BUTTON_EVENT_QUEUE_SIZE - 1)
+
+#if BUTTON_EVENT_QUEUE_SIZE & QUEUE_MASK
+#error "BUTTON_EVENT_QUEUE_SIZE must be a power of two"
+#endif
+
+static button_event_t _queue[BUTTON_EVENT_QUEUE_SIZE];
+static uint32_t _head; // next free slot
+static uint32_t _tail; // oldest change not yet reported
+
+static uint32_t _committed[BUTTON_EVENTS_WORDS]; // state of the last queued report
+static uint32_t _requested[BUTTON_EVENTS_WORDS]; // state after all latched changes
+static button_events_stats_t _stats;
+
+static inline bool test_bit(const uint32_t *bits, uint8_t button)
+{
+  return (bits[button >> 5] >> (button & 31)) & 1u;
+}
+
+static inline void put_bit(uint32_t *bits, uint8_t button, bool value)
+{
+  const uint32_t bit = 1u << (button & 31);
+  bits[button >> 5] = value ? bits[button >> 5] | bit : bits[button >> 5] & ~bit;
+}
+
+// bitmaps have a constant size, these compile to a few word moves
+static inline void copy_bits(uint32_t *to, const uint32_t *from)
+{
+  memcpy(to, from, BUTTON_EVENTS_WORDS * sizeof(uint32_t));
+}
+
+void button_events_set(uint8_t button, bool pressed)
+{
+  if (button >= BUTTON_EVENTS_MAX_BUTTONS)
+    return;
+
+  uint32_t status = save_and_disable_interrupts();
+
+  if (test_bit(_requested, button) != pressed)
+  {
+    put_bit(_requested, button, pressed);
+    _stats.events++;
+
+    if (_head - _tail < BUTTON_EVENT_QUEUE_SIZE)
+    {
+      button_event_t *e = &_queue[_head++ & QUEUE_MASK];
+      e->timestamp_us = time_us_32();
+      e->button = button;
+      e->pressed = pressed;
+    }
+    else
+    {
+      // picked up by collect once the queue drained
+      _stats.overflows++;
+    }
+    trace_event(TRACE_BUTTON_EVENT, button | (pressed ? 0x100 : 0));
+  }
+
+  restore_interrupts(status);
+}
+
+void button_events_requested(uint32_t buttons[BUTTON_EVENTS_WORDS])
+{
+  uint32_t status = save_and_disable_interrupts();
+  copy_bits(buttons, _requested);
+  restore_interrupts(status);
+}
+
+uint32_t button_events_collect(uint32_t buttons[BUTTON_EVENTS_WORDS])
+{
+  uint32_t changed[BUTTON_EVENTS_WORDS] = {0};
+  uint32_t status = save_and_disable_interrupts();
+  uint32_t i = _tail;
+
+  copy_bits(buttons, _committed);
+  for (; i != _head; ++i)
+  {
+    const button_event_t *e = &_queue[i & QUEUE_MASK];
+    if (test_bit(changed, e->button))
+    {
+      _stats.deferred++;
+      break;
+    }
+    put_bit(changed, e->button, true);
+    put_bit(buttons, e->button, e->pressed);
+  }
+
+  // overflowed changes only exist in the requested state
+  if (i == _head)
+    copy_bits(buttons, _requested);
+
+  const uint32_t count = i - _tail;
+  restore_interrupts(status);
+  return count;
+}
+
+void button_events_commit(uint32_t count)
+{
+  const uint32_t now = time_us_32();
+  uint32_t status = save_and_disable_interrupts();
+
+  for (uint32_t i = 0; i < count && _tail != _head; ++i, ++_tail)
+  {
+    const button_event_t *e = &_queue[_tail & QUEUE_MASK];
+    put_bit(_committed, e->button, e->pressed);
+
+    if (now - e->timestamp_us > _stats.max_latency_us)
+      _stats.max_latency_us = now - e->timestamp_us;
+  }
+  if (_tail == _head)
+    copy_bits(_committed, _requested);
+
+  restore_interrupts(status);
+}
+
+bool button_events_pending(void)
+{
+  if (_tail != _head)
+    return true;
+
+  return memcmp(_committed, _requested, sizeof(_committed)) != 0;
+}
+
+void button_events_get_stats(button_events_stats_t *stats)
+{
+  *stats = _stats;
+}
@@ -0,0 +1,73 @@
+#ifndef _tmext_button_events_h
+#define _tmext_button_events_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "joystick.h"
+
+// Presses and releases are latched in a queue and handed to reports in order, so a tap
+// shorter than the report interval still shows up pressed in at least one report.
+
+#define BUTTON_EVENTS_MAX_BUTTONS TM_JOYSTICK_BUTTON_COUNT
+// button bitmaps are arrays of this many words, bit n of word w is button 32 * w + n
+#define BUTTON_EVENTS_WORDS ((BUTTON_EVENTS_MAX_BUTTONS + 31) / 32)
+
+#ifndef BUTTON_EVENT_QUEUE_SIZE
+#define BUTTON_EVENT_QUEUE_SIZE 32 // power of two
+#endif
+
+  typedef struct
+  {
+    uint32_t timestamp_us;
+    uint8_t button;
+    bool pressed;
+  } button_event_t;
+
+  typedef struct
+  {
+    uint32_t events;         // state changes queued
+    uint32_t overflows;      // changes that found the queue full, only the final state is reported
+    uint32_t deferred;       // reports that held events back so an earlier change stays visible
+    uint32_t max_latency_us; // longest time from a change to the report carrying it being queued
+  } button_events_stats_t;
+
+  /**
+   * @brief latch a button state, repeated calls with the same state are ignored
+   *
+   * Safe from interrupt handlers of core 0.
+   */
+  void button_events_set(uint8_t button, bool pressed);
+
+  // state after every latched change
+  void button_events_requested(uint32_t buttons[BUTTON_EVENTS_WORDS]);
+
+  /**
+   * @brief buttons for the next report
+   *
+   * Applies queued changes oldest first and stops before one that would undo a change
+   * already in this report, e.g. the release of a tap.
+   *
+   * @param[out] buttons : state for the report
+   * @return number of changes included, pass to button_events_commit
+   */
+  uint32_t button_events_collect(uint32_t buttons[BUTTON_EVENTS_WORDS]);
+
+  /**
+   * @brief the report from the last button_events_collect was queued, drop its changes
+   */
+  void button_events_commit(uint32_t count);
+
+  // whether changes wait for a report
+  bool button_events_pending(void);
+
+  void button_events_get_stats(button_events_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_button_events_h */
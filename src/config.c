@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "config.h"
+#include "usb_descriptors.h"
+#include "usb_diagnostics.h"
+#include "report_cache.h"
+#include "settings.h"
+#include "hid_reporter.h"
+#include "hall_sensor.h"
+#include "display_task.h"
+#include "axis_scale.h"
+
+_Static_assert(CONFIG_PAYLOAD_SIZE == DIAG_PAYLOAD_SIZE, "configuration shares the diagnostics report size");
+_Static_assert(CONFIG_PAYLOAD_SIZE <= REPORT_CACHE_FEATURE_SIZE, "configuration reports are cached");
+_Static_assert(TM_JOYSTICK_AXIS_COUNT <= CONFIG_MAX_AXES, "every axis is configurable");
+_Static_assert(CONFIG_CURVE_POINTS == AXIS_SHAPE_POINTS && CONFIG_CURVE_ONE == AXIS_SHAPE_ONE, "curves are passed as they are");
+
+static config_state_t _state;
+
+// a range the scale cannot resolve would report the minimum forever
+static bool check_axis(uint8_t index, const config_axis_t *axis)
+{
+  return tm_joystick_checkAxisRange(index, axis->in_from, axis->in_to);
+}
+
+// refresh the answers to GET, the host reads them from the report cache
+static void publish(void)
+{
+  static const uint8_t reports[] = {CONFIG_REPORT_DEVICE, CONFIG_REPORT_AXIS, CONFIG_REPORT_COMMAND};
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+
+  for (uint32_t i = 0; i < sizeof(reports); ++i)
+  {
+    config_protocol_get_report(&_state, reports[i], payload);
+    report_cache_set_feature(HID_INSTANCE_DIAG, reports[i], payload, sizeof(payload));
+  }
+}
+
+// hand the values to their modules, the settings in RAM follow, flash only on save
+static void apply(const config_values_t *values)
+{
+  hid_reporter_set_min_interval(values->min_report_interval_us);
+  hall_sensor_set_filter(values->filter_shift);
+  display_task_set_mode((display_mode_t)values->display_mode);
+
+  settings_set_poll_interval(values->poll_interval_ms);
+  settings_set_min_report_interval(values->min_report_interval_us);
+  settings_set_filter_shift(values->filter_shift);
+  settings_set_display_mode(values->display_mode);
+
+  for (uint8_t axis = 0; axis < values->axis_count; ++axis)
+  {
+    const config_axis_t *a = &values->axes[axis];
+    tm_joystick_configureAxis(axis, a->in_from, a->in_to, a->deadzone_center, a->deadzone_edge, a->curve);
+    settings_set_axis(axis, a);
+  }
+}
+
+void config_init(void)
+{
+  const tm_settings_t *settings = settings_get();
+  config_values_t *defaults = &_state.defaults;
+
+  memset(&_state, 0, sizeof(_state));
+  _state.display_mode_count = DISPLAY_MODE_COUNT;
+  _state.check_axis = check_axis;
+
+  defaults->axis_count = TM_JOYSTICK_AXIS_COUNT;
+  defaults->poll_interval_ms = HID_POLL_INTERVAL_MS;
+  defaults->min_report_interval_us = HID_REPORTER_DEFAULT_MIN_INTERVAL_US;
+  defaults->filter_shift = HALL_SENSOR_DEFAULT_FILTER_SHIFT;
+  defaults->display_mode = DISPLAY_TASK_DEFAULT_MODE;
+  for (uint8_t axis = 0; axis < TM_JOYSTICK_AXIS_COUNT; ++axis)
+  {
+    int32_t in_min, in_max;
+    tm_joystick_getAxisRange(axis, &in_min, &in_max);
+    config_axis_defaults(&defaults->axes[axis], in_min, in_max);
+  }
+
+  // stored values that do not validate keep their defaults
+  config_values_t values = *defaults;
+  values.poll_interval_ms = settings->poll_interval_ms;
+  values.min_report_interval_us = settings->min_report_interval_us;
+  values.filter_shift = settings->filter_shift;
+  values.display_mode = settings->display_mode;
+  if (!config_valid_device(&values, _state.display_mode_count))
+    values = *defaults;
+
+  for (uint8_t axis = 0; axis < TM_JOYSTICK_AXIS_COUNT; ++axis)
+  {
+    if (config_valid_axis(&settings->axes[axis]) && check_axis(axis, &settings->axes[axis]))
+      values.axes[axis] = settings->axes[axis];
+  }
+
+  _state.active = values;
+  _state.staged = values;
+  apply(&_state.active);
+  publish();
+}
+
+bool config_set_report(uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
+{
+  if (report_type != HID_REPORT_TYPE_FEATURE)
+    return false;
+
+  // some stack versions pass the report ID as the first byte
+  if (bufsize > CONFIG_PAYLOAD_SIZE && buffer[0] == report_id)
+  {
+    buffer++;
+    bufsize--;
+  }
+
+  if (!config_protocol_set_report(&_state, report_id, buffer, bufsize))
+    return false;
+
+  publish();
+  return true;
+}
+
+void config_task(void)
+{
+  if (!_state.pending)
+    return;
+
+  const uint8_t pending = config_protocol_take_pending(&_state);
+  if (pending & CONFIG_PENDING_APPLY)
+    apply(&_state.active);
+  if (pending & CONFIG_PENDING_SAVE)
+    settings_save();
+  publish();
+}
@@ -0,0 +1,42 @@
+#ifndef _tmext_config_h
+#define _tmext_config_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include "config_protocol.h"
+
+  // Live configuration of axis ranges, deadzones, curves, sensor filter, report rate and
+  // display mode, see config_protocol.h for the feature reports. GET requests are answered
+  // from the report cache, which is refreshed on every change.
+
+  /**
+   * @brief apply the persisted settings, falling back to defaults for invalid ones
+   *
+   * Call after settings_init, tm_joystick_setup, hid_reporter_init and display_task_init.
+   */
+  void config_init(void);
+
+  /**
+   * @brief called from tud_hid_set_report_cb for the diagnostics instance
+   *
+   * @return false if report_id is not a configuration report
+   */
+  bool config_set_report(uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize);
+
+  /**
+   * @brief make requested changes active, call right before building a report
+   *
+   * A save writes flash with interrupts disabled and stalls USB for the duration.
+   */
+  void config_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_config_h */
@@ -0,0 +1,269 @@
+#include <string.h>
+
+#include "config_protocol.h"
+
+// longest accepted minimum report interval, slower than any poll interval
+#define CONFIG_MAX_REPORT_INTERVAL_US 100000
+// hall_sensor_set_filter limit
+#define CONFIG_MAX_FILTER_SHIFT 15
+
+static void put_u16(uint8_t *dst, uint16_t value)
+{
+  dst[0] = (uint8_t)value;
+  dst[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+  put_u16(dst, (uint16_t)value);
+  put_u16(dst + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *src)
+{
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *src)
+{
+  return get_u16(src) | ((uint32_t)get_u16(src + 2) << 16);
+}
+
+void config_axis_defaults(config_axis_t *axis, int32_t in_from, int32_t in_to)
+{
+  memset(axis, 0, sizeof(*axis));
+  axis->in_from = in_from;
+  axis->in_to = in_to;
+  for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+    axis->curve[i] = (uint16_t)(i * (CONFIG_CURVE_ONE / (CONFIG_CURVE_POINTS - 1)));
+}
+
+bool config_valid_device(const config_values_t *values, uint8_t display_mode_count)
+{
+  const uint8_t poll = values->poll_interval_ms;
+  return (poll == 1 || poll == 2 || poll == 4 || poll == 8) &&
+         values->min_report_interval_us <= CONFIG_MAX_REPORT_INTERVAL_US &&
+         values->filter_shift <= CONFIG_MAX_FILTER_SHIFT &&
+         values->display_mode < display_mode_count;
+}
+
+bool config_valid_axis(const config_axis_t *axis)
+{
+  // axis_scale works on spans that fit an int32_t
+  const int64_t span = (int64_t)axis->in_to - axis->in_from;
+  if (span == 0 || span > INT32_MAX || span < -INT32_MAX)
+    return false;
+  if ((uint32_t)axis->deadzone_center + axis->deadzone_edge >= CONFIG_CURVE_ONE)
+    return false;
+
+  for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+  {
+    if (axis->curve[i] > CONFIG_CURVE_ONE || (i > 0 && axis->curve[i] < axis->curve[i - 1]))
+      return false;
+  }
+  return true;
+}
+
+void config_put_device(uint8_t *payload, const config_values_t *values, uint8_t display_mode_count)
+{
+  memset(payload, 0, CONFIG_PAYLOAD_SIZE);
+  payload[0] = CONFIG_PROTOCOL_VERSION;
+  payload[1] = values->axis_count;
+  payload[2] = display_mode_count;
+  payload[3] = values->poll_interval_ms;
+  put_u32(&payload[4], values->min_report_interval_us);
+  payload[8] = values->filter_shift;
+  payload[9] = values->display_mode;
+}
+
+bool config_get_device(const uint8_t *payload, uint16_t len, config_values_t *values)
+{
+  if (len < 10)
+    return false;
+
+  values->axis_count = payload[1];
+  values->poll_interval_ms = payload[3];
+  values->min_report_interval_us = get_u32(&payload[4]);
+  values->filter_shift = payload[8];
+  values->display_mode = payload[9];
+  return true;
+}
+
+void config_put_axis(uint8_t *payload, uint8_t index, const config_axis_t *axis)
+{
+  memset(payload, 0, CONFIG_PAYLOAD_SIZE);
+  payload[0] = CONFIG_PROTOCOL_VERSION;
+  payload[1] = index;
+  put_u32(&payload[4], (uint32_t)axis->in_from);
+  put_u32(&payload[8], (uint32_t)axis->in_to);
+  put_u16(&payload[12], axis->deadzone_center);
+  put_u16(&payload[14], axis->deadzone_edge);
+  for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+    put_u16(&payload[16 + 2 * i], axis->curve[i]);
+}
+
+bool config_get_axis(const uint8_t *payload, uint16_t len, uint8_t *index, config_axis_t *axis)
+{
+  if (len < 16 + 2 * CONFIG_CURVE_POINTS)
+    return false;
+
+  memset(axis, 0, sizeof(*axis));
+  *index = payload[1];
+  axis->in_from = (int32_t)get_u32(&payload[4]);
+  axis->in_to = (int32_t)get_u32(&payload[8]);
+  axis->deadzone_center = get_u16(&payload[12]);
+  axis->deadzone_edge = get_u16(&payload[14]);
+  for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+    axis->curve[i] = get_u16(&payload[16 + 2 * i]);
+  return true;
+}
+
+void config_put_command(uint8_t *payload, config_command_t command, uint8_t argument)
+{
+  memset(payload, 0, CONFIG_PAYLOAD_SIZE);
+  payload[0] = CONFIG_PROTOCOL_VERSION;
+  payload[1] = (uint8_t)command;
+  payload[2] = argument;
+}
+
+void config_put_status(uint8_t *payload, const config_status_t *status)
+{
+  memset(payload, 0, CONFIG_PAYLOAD_SIZE);
+  payload[0] = CONFIG_PROTOCOL_VERSION;
+  payload[1] = status->flags;
+  payload[2] = status->selected_axis;
+  payload[3] = status->result;
+  put_u32(&payload[4], status->generation);
+}
+
+bool config_get_status(const uint8_t *payload, uint16_t len, config_status_t *status)
+{
+  if (len < 8)
+    return false;
+
+  status->flags = payload[1];
+  status->selected_axis = payload[2];
+  status->result = payload[3];
+  status->generation = get_u32(&payload[4]);
+  return true;
+}
+
+bool config_protocol_get_report(const config_state_t *state, uint8_t report_id, uint8_t *payload)
+{
+  switch (report_id)
+  {
+  case CONFIG_REPORT_DEVICE:
+    config_put_device(payload, &state->staged, state->display_mode_count);
+    return true;
+  case CONFIG_REPORT_AXIS:
+    config_put_axis(payload, state->selected_axis, &state->staged.axes[state->selected_axis]);
+    return true;
+  case CONFIG_REPORT_COMMAND:
+  {
+    config_status_t status = {
+        .flags = (uint8_t)((memcmp(&state->staged, &state->active, sizeof(config_values_t)) ? CONFIG_STATUS_STAGED : 0) |
+                           (state->pending ? CONFIG_STATUS_PENDING : 0)),
+        .selected_axis = state->selected_axis,
+        .result = state->result,
+        .generation = state->generation,
+    };
+    config_put_status(payload, &status);
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+static config_result_t set_device(config_state_t *state, const uint8_t *payload, uint16_t len)
+{
+  config_values_t values = state->staged;
+  if (!config_get_device(payload, len, &values))
+    return CONFIG_ERROR_LENGTH;
+
+  // fixed by the descriptor
+  values.axis_count = state->staged.axis_count;
+  if (!config_valid_device(&values, state->display_mode_count))
+    return CONFIG_ERROR_RANGE;
+
+  state->staged = values;
+  return CONFIG_OK;
+}
+
+static config_result_t set_axis(config_state_t *state, const uint8_t *payload, uint16_t len)
+{
+  uint8_t index;
+  config_axis_t axis;
+  if (!config_get_axis(payload, len, &index, &axis))
+    return CONFIG_ERROR_LENGTH;
+  if (index >= state->staged.axis_count)
+    return CONFIG_ERROR_AXIS;
+  if (!config_valid_axis(&axis) || (state->check_axis && !state->check_axis(index, &axis)))
+    return CONFIG_ERROR_RANGE;
+
+  state->staged.axes[index] = axis;
+  state->selected_axis = index;
+  return CONFIG_OK;
+}
+
+static config_result_t command(config_state_t *state, const uint8_t *payload, uint16_t len)
+{
+  if (len < 3)
+    return CONFIG_ERROR_LENGTH;
+
+  switch (payload[1])
+  {
+  case CONFIG_COMMAND_SELECT_AXIS:
+    if (payload[2] >= state->staged.axis_count)
+      return CONFIG_ERROR_AXIS;
+    state->selected_axis = payload[2];
+    return CONFIG_OK;
+  case CONFIG_COMMAND_APPLY:
+    state->pending |= CONFIG_PENDING_APPLY;
+    return CONFIG_OK;
+  case CONFIG_COMMAND_REVERT:
+    state->staged = state->active;
+    return CONFIG_OK;
+  case CONFIG_COMMAND_SAVE:
+    state->pending |= CONFIG_PENDING_APPLY | CONFIG_PENDING_SAVE;
+    return CONFIG_OK;
+  case CONFIG_COMMAND_DEFAULTS:
+    state->staged = state->defaults;
+    return CONFIG_OK;
+  default:
+    return CONFIG_ERROR_COMMAND;
+  }
+}
+
+bool config_protocol_set_report(config_state_t *state, uint8_t report_id, const uint8_t *payload, uint16_t len)
+{
+  config_result_t result;
+
+  if (report_id != CONFIG_REPORT_DEVICE && report_id != CONFIG_REPORT_AXIS && report_id != CONFIG_REPORT_COMMAND)
+    return false;
+
+  if (len < 1 || payload[0] != CONFIG_PROTOCOL_VERSION)
+    result = CONFIG_ERROR_VERSION;
+  else if (report_id == CONFIG_REPORT_DEVICE)
+    result = set_device(state, payload, len);
+  else if (report_id == CONFIG_REPORT_AXIS)
+    result = set_axis(state, payload, len);
+  else
+    result = command(state, payload, len);
+
+  state->result = (uint8_t)result;
+  return true;
+}
+
+uint8_t config_protocol_take_pending(config_state_t *state)
+{
+  const uint8_t pending = state->pending;
+  state->pending = 0;
+
+  if (pending & CONFIG_PENDING_APPLY)
+  {
+    state->active = state->staged;
+    state->generation++;
+  }
+  return pending;
+}
@@ -0,0 +1,157 @@
+#ifndef _tmext_config_protocol_h
+#define _tmext_config_protocol_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Only the C library, the module is shared with tools/tmconfig.c and builds on the host.
+#include <stdint.h>
+#include <stdbool.h>
+
+// Live configuration over feature reports of the diagnostics interface. Payloads follow
+// the report ID, multi byte fields are little endian and byte 0 of every payload is
+// CONFIG_PROTOCOL_VERSION. A SET with another version is rejected, later versions only
+// append fields.
+//
+// SET reports change a staged copy of the configuration, CONFIG_COMMAND_APPLY makes the
+// whole staged copy active at once, between two joystick reports.
+#define CONFIG_PROTOCOL_VERSION 1
+#define CONFIG_PAYLOAD_SIZE 63
+
+#define CONFIG_MAX_AXES 8
+#define CONFIG_CURVE_POINTS 9  // response at 0, 1/8 ... 8/8 of the deflection from center
+#define CONFIG_CURVE_ONE 32768 // full deflection in deadzone and curve units
+
+  enum
+  {
+    // GET: staged device settings, SET: stage them
+    //   1 axis count (GET only), 2 display mode count (GET only), 3 HID poll interval ms,
+    //   4 minimum report interval us u32, 8 sensor filter shift, 9 display mode
+    CONFIG_REPORT_DEVICE = 7,
+    // GET: staged settings of the selected axis, SET: stage them and select the axis
+    //   1 axis, 4 input from i32, 8 input to i32 (from > to reverses the axis),
+    //   12 center deadzone u16, 14 edge deadzone u16, 16 curve, CONFIG_CURVE_POINTS u16
+    CONFIG_REPORT_AXIS = 8,
+    // GET: status
+    //   1 flags, 2 selected axis, 3 result of the last SET, 4 configurations applied u32
+    // SET: 1 command, 2 argument
+    CONFIG_REPORT_COMMAND = 9,
+  };
+
+  typedef enum
+  {
+    CONFIG_COMMAND_SELECT_AXIS = 1, // argument is the axis GET CONFIG_REPORT_AXIS returns
+    CONFIG_COMMAND_APPLY = 2,       // make the staged configuration active
+    CONFIG_COMMAND_REVERT = 3,      // drop staged changes
+    CONFIG_COMMAND_SAVE = 4,        // apply and write to flash
+    CONFIG_COMMAND_DEFAULTS = 5,    // stage the build time defaults
+  } config_command_t;
+
+  typedef enum
+  {
+    CONFIG_OK = 0,
+    CONFIG_ERROR_VERSION,  // payload of another protocol version
+    CONFIG_ERROR_LENGTH,   // payload too short
+    CONFIG_ERROR_AXIS,     // no such axis
+    CONFIG_ERROR_RANGE,    // a value is out of range, nothing was staged
+    CONFIG_ERROR_COMMAND,  // unknown command
+  } config_result_t;
+
+#define CONFIG_STATUS_STAGED 0x01  // staged configuration differs from the active one
+#define CONFIG_STATUS_PENDING 0x02 // apply or save waits for the next report
+
+  typedef struct
+  {
+    int32_t in_from; // raw value reported as the minimum
+    int32_t in_to;   // raw value reported as the maximum
+    uint16_t deadzone_center;
+    uint16_t deadzone_edge;
+    uint16_t curve[CONFIG_CURVE_POINTS]; // non decreasing, 0 to CONFIG_CURVE_ONE
+  } config_axis_t;
+
+  typedef struct
+  {
+    uint8_t axis_count;
+    uint8_t poll_interval_ms;
+    uint8_t filter_shift;
+    uint8_t display_mode;
+    uint32_t min_report_interval_us;
+    config_axis_t axes[CONFIG_MAX_AXES];
+  } config_values_t;
+
+  typedef struct
+  {
+    uint8_t flags;
+    uint8_t selected_axis;
+    uint8_t result;
+    uint32_t generation;
+  } config_status_t;
+
+#define CONFIG_PENDING_APPLY 0x01
+#define CONFIG_PENDING_SAVE 0x02
+
+  // device side state, zero it and fill in defaults, active and staged before use
+  typedef struct
+  {
+    config_values_t defaults;
+    config_values_t active;
+    config_values_t staged;
+    uint8_t display_mode_count;
+    uint8_t selected_axis;
+    uint8_t result;
+    uint8_t pending;     // CONFIG_PENDING_*
+    uint32_t generation; // configurations applied
+    // device specific check on top of config_valid_axis, NULL if there is none
+    bool (*check_axis)(uint8_t index, const config_axis_t *axis);
+  } config_state_t;
+
+  // no deadzone and a linear response over in_from - in_to
+  void config_axis_defaults(config_axis_t *axis, int32_t in_from, int32_t in_to);
+
+  bool config_valid_device(const config_values_t *values, uint8_t display_mode_count);
+
+  bool config_valid_axis(const config_axis_t *axis);
+
+  // Payload codecs, put fills all CONFIG_PAYLOAD_SIZE bytes, get returns false when len is too short
+
+  void config_put_device(uint8_t *payload, const config_values_t *values, uint8_t display_mode_count);
+  bool config_get_device(const uint8_t *payload, uint16_t len, config_values_t *values);
+
+  void config_put_axis(uint8_t *payload, uint8_t index, const config_axis_t *axis);
+  bool config_get_axis(const uint8_t *payload, uint16_t len, uint8_t *index, config_axis_t *axis);
+
+  void config_put_command(uint8_t *payload, config_command_t command, uint8_t argument);
+
+  void config_put_status(uint8_t *payload, const config_status_t *status);
+  bool config_get_status(const uint8_t *payload, uint16_t len, config_status_t *status);
+
+  // Device side
+
+  /**
+   * @brief payload of a GET for one of the CONFIG_REPORT_* reports
+   *
+   * @return false if report_id is not a configuration report
+   */
+  bool config_protocol_get_report(const config_state_t *state, uint8_t report_id, uint8_t *payload);
+
+  /**
+   * @brief handle a SET, the result is reported in the status
+   *
+   * @return false if report_id is not a configuration report
+   */
+  bool config_protocol_set_report(config_state_t *state, uint8_t report_id, const uint8_t *payload, uint16_t len);
+
+  /**
+   * @brief take the requested apply and save, the staged values become active
+   *
+   * @return CONFIG_PENDING_* bits that were requested, the caller applies state->active
+   */
+  uint8_t config_protocol_take_pending(config_state_t *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_config_protocol_h */
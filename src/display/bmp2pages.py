@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""
+Convert monochrome images to page ordered ssd1306 bitmaps.
+
+Reads 1 bit uncompressed .bmp files and plain or raw .pbm files and writes a
+C source and header pair with one const ssd1306_page_image_t per image, named
+ssd1306_image_<file stem>. Pixels are stored the way the display RAM holds
+them: ceil(height / 8) pages of width bytes, bit 0 is the top row of a page.
+
+Black pixels are lit, which matches ssd1306_bmp_show_image and the PBM
+convention of 1 meaning black.
+
+usage: bmp2pages.py -o <output path without extension> image...
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+
+def read_bmp(data):
+    if len(data) < 54 or data[0:2] != b'BM':
+        raise ValueError('not a BMP file')
+
+    off_bits, = struct.unpack_from('<I', data, 10)
+    header_size, width, height = struct.unpack_from('<Iii', data, 14)
+    bit_count, compression = struct.unpack_from('<HI', data, 28)
+    if bit_count != 1:
+        raise ValueError('image not monochrome')
+    if compression != 0:
+        raise ValueError('image compressed')
+
+    # palette index that is black is drawn, same as the runtime parser
+    table = 14 + header_size
+    lit = 0
+    for i in range(2):
+        b, g, r = data[table + i * 4:table + i * 4 + 3]
+        if (r | g | b) == 0:
+            lit = i
+            break
+
+    stride = ((width + 31) // 32) * 4
+    rows = []
+    for row in range(abs(height)):
+        line = data[off_bits + row * stride:off_bits + (row + 1) * stride]
+        rows.append([((line[x >> 3] >> (7 - (x & 7))) & 1) == lit for x in range(width)])
+    if height > 0:
+        rows.reverse()
+    return width, abs(height), rows
+
+
+def read_pbm(data):
+    magic = data[0:2]
+    if magic not in (b'P1', b'P4'):
+        raise ValueError('not a PBM file')
+
+    # header tokens, comments run to the end of the line
+    pos = 2
+    tokens = []
+    while len(tokens) < 2:
+        match = re.compile(rb'\s*(#[^\n]*\n\s*)*(\d+)').match(data, pos)
+        if not match:
+            raise ValueError('broken PBM header')
+        tokens.append(int(match.group(2)))
+        pos = match.end()
+    width, height = tokens
+
+    if magic == b'P4':
+        pos += 1  # single whitespace before the raster
+        stride = (width + 7) // 8
+        rows = []
+        for row in range(height):
+            line = data[pos + row * stride:pos + (row + 1) * stride]
+            rows.append([bool((line[x >> 3] >> (7 - (x & 7))) & 1) for x in range(width)])
+        return width, height, rows
+
+    bits = [c == ord('1') for c in re.sub(rb'#[^\n]*', b'', data[pos:]) if c in b'01']
+    if len(bits) < width * height:
+        raise ValueError('truncated PBM raster')
+    return width, height, [bits[row * width:(row + 1) * width] for row in range(height)]
+
+
+def to_pages(width, height, rows):
+    pages = []
+    for page in range((height + 7) // 8):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and rows[y][x]:
+                    byte |= 1 << bit
+            pages.append(byte)
+    return pages
+
+
+def symbol(path):
+    stem = os.path.splitext(os.path.basename(path))[0]
+    return 'ssd1306_image_' + re.sub(r'\W', '_', stem).lower()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='convert images to ssd1306 page bitmaps')
+    parser.add_argument('-o', '--output', required=True, help='output path without extension')
+    parser.add_argument('images', nargs='*')
+    args = parser.parse_args()
+
+    images = []
+    for path in sorted(args.images, key=symbol):
+        with open(path, 'rb') as f:
+            data = f.read()
+        try:
+            if path.lower().endswith('.bmp'):
+                width, height, rows = read_bmp(data)
+            else:
+                width, height, rows = read_pbm(data)
+        except ValueError as e:
+            sys.exit('%s: %s' % (path, e))
+        if width > 255 or height > 255:
+            sys.exit('%s: image larger than 255 pixels' % path)
+        images.append((symbol(path), os.path.basename(path), width, height, to_pages(width, height, rows)))
+
+    name = os.path.basename(args.output)
+    guard = '_%s_h' % re.sub(r'\W', '_', name).lower()
+
+    with open(args.output + '.h', 'w') as h:
+        h.write('// generated by bmp2pages.py, do not edit\n\n')
+        h.write('#ifndef %s\n#define %s\n\n#include "ssd1306.h"\n\n' % (guard, guard))
+        h.write('#ifdef __cplusplus\nextern "C" {\n#endif\n\n')
+        for sym, source, width, height, _ in images:
+            h.write('/** %s, %ux%u */\nextern const ssd1306_page_image_t %s;\n\n' % (source, width, height, sym))
+        h.write('#ifdef __cplusplus\n}\n#endif\n\n#endif /* %s */\n' % guard)
+
+    with open(args.output + '.c', 'w') as c:
+        c.write('// generated by bmp2pages.py, do not edit\n\n#include "%s.h"\n' % name)
+        for sym, _, width, height, pages in images:
+            c.write('\nstatic const uint8_t %s_pages[] = {\n' % sym)
+            for i in range(0, len(pages), 16):
+                c.write('    %s,\n' % ', '.join('0x%02x' % b for b in pages[i:i + 16]))
+            c.write('};\n\nconst ssd1306_page_image_t %s = {\n' % sym)
+            c.write('    .width = %u,\n    .height = %u,\n    .pages = %s_pages,\n};\n' % (width, height, sym))
+
+
+if __name__ == '__main__':
+    main()
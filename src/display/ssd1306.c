@@ -25,25 +25,26 @@ SOFTWARE.
 
 #include <pico/stdlib.h>
 #include <hardware/i2c.h>
+#include <hardware/dma.h>
 #include <pico/binary_info.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <math.h>
 
 #include "ssd1306.h"
 #include "font.h"
 
 inline static void swap(int32_t *a, int32_t *b)
 {
-    const int32_t *t = a;
+    const int32_t t = *a;
     *a = *b;
-    *b = *t;
+    *b = t;
 }
 
-inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name)
+inline static int fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, char *name)
 {
-    switch (i2c_write_blocking(i2c, addr, src, len, false))
+    int ret = i2c_write_blocking(i2c, addr, src, len, false);
+    switch (ret)
     {
     case PICO_ERROR_GENERIC:
         printf("[%s] addr not acknowledged!\n", name);
@@ -54,23 +55,106 @@ inline static void fancy_write(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src
     default:
         break;
     }
+    return ret;
+}
+
+static inline void ssd1306_wait_idle(ssd1306_t *p)
+{
+    while (ssd1306_busy(p))
+        tight_loop_contents();
+}
+
+// not every panel or pull-up copes with Fast-mode Plus, stay at Fast-mode after the first NAK
+static bool ssd1306_slow_down(ssd1306_t *p)
+{
+    if (p->baudrate <= SSD1306_I2C_BAUDRATE)
+        return false;
+
+    p->baudrate = i2c_set_baudrate(p->i2c_i, SSD1306_I2C_BAUDRATE);
+    return true;
+}
+
+static bool ssd1306_i2c_write(ssd1306_t *p, const uint8_t *src, size_t len, char *name)
+{
+    if (fancy_write(p->i2c_i, p->address, src, len, name) == (int)len)
+        return true;
+
+    return ssd1306_slow_down(p) && fancy_write(p->i2c_i, p->address, src, len, name) == (int)len;
+}
+
+bool ssd1306_write_cmds(ssd1306_t *p, const uint8_t *cmds, size_t len)
+{
+    if (len > SSD1306_MAX_CMDS)
+        return false;
+
+    uint8_t d[SSD1306_MAX_CMDS + 1];
+    d[0] = 0x00;
+    memcpy(d + 1, cmds, len);
+
+    ssd1306_wait_idle(p);
+    return ssd1306_i2c_write(p, d, len + 1, "ssd1306_write_cmds");
 }
 
 inline static void ssd1306_write(ssd1306_t *p, uint8_t val)
 {
-    uint8_t d[2] = {0x00, val};
-    fancy_write(p->i2c_i, p->address, d, 2, "ssd1306_write");
+    ssd1306_write_cmds(p, &val, 1);
 }
 
+// from https://github.com/makerportal/rpi-pico-ssd1306
+// control byte and the whole init sequence, sent as one transaction after patching the marked bytes
+static const uint8_t ssd1306_init_cmds[] = {
+    0x00,            // control byte, command stream
+    SET_DISP | 0x00, // off
+    // address setting
+    SET_MEM_ADDR,
+    0x00, // horizontal
+    // resolution and layout
+    SET_DISP_START_LINE | 0x00,
+    SET_SEG_REMAP | 0x01, // column addr 127 mapped to SEG0
+    SET_MUX_RATIO,
+    63, // patched: height - 1
+    SET_COM_OUT_DIR | 0x08, // scan from COM[N] to COM0
+    SET_DISP_OFFSET,
+    0x00,
+    SET_COM_PIN_CFG,
+    0x12, // patched: 0x02 for wide panels
+    // timing and driving scheme
+    SET_DISP_CLK_DIV,
+    0x80,
+    SET_PRECHARGE,
+    0xF1, // patched: 0x22 with external vcc
+    SET_VCOM_DESEL,
+    0x30, // 0.83*Vcc
+    // display
+    SET_CONTRAST,
+    0xFF,          // maximum
+    SET_ENTIRE_ON, // output follows RAM contents
+    SET_NORM_INV,  // not inverted
+    // charge pump
+    SET_CHARGE_PUMP,
+    0x14, // patched: 0x10 with external vcc
+    SET_DISP | 0x01};
+
+// offsets of the patched bytes in ssd1306_init_cmds
+enum {
+    INIT_MUX_RATIO = 7,
+    INIT_COM_PIN_CFG = 12,
+    INIT_PRECHARGE = 16,
+    INIT_CHARGE_PUMP = 24
+};
+
 bool ssd1306_init(ssd1306_t *p, uint8_t width, uint8_t height, uint8_t address, i2c_inst_t *i2c_instance, uint sda_pin, uint scl_pin)
 {
-    i2c_init(i2c_instance, 400 *1000);
+#if SSD1306_FAST_MODE_PLUS
+    p->baudrate = i2c_init(i2c_instance, SSD1306_I2C_BAUDRATE_FAST_PLUS);
+#else
+    p->baudrate = i2c_init(i2c_instance, SSD1306_I2C_BAUDRATE);
+#endif
     gpio_set_function(sda_pin, GPIO_FUNC_I2C);
     gpio_set_function(scl_pin, GPIO_FUNC_I2C);
     gpio_pull_up(sda_pin);
     gpio_pull_up(scl_pin);
     p->external_vcc=false;
-    ssd1306_clear(p);
 
     p->width = width;
     p->height = height;
@@ -88,48 +172,45 @@ bool ssd1306_init(ssd1306_t *p, uint8_t width, uint8_t height, uint8_t address,
 
     ++(p->buffer);
 
-    // from https://github.com/makerportal/rpi-pico-ssd1306
-    int8_t cmds[] = {
-        SET_DISP | 0x00, // off
-        // address setting
-        SET_MEM_ADDR,
-        0x00, // horizontal
-        // resolution and layout
-        SET_DISP_START_LINE | 0x00,
-        SET_SEG_REMAP | 0x01, // column addr 127 mapped to SEG0
-        SET_MUX_RATIO,
-        height - 1,
-        SET_COM_OUT_DIR | 0x08, // scan from COM[N] to COM0
-        SET_DISP_OFFSET,
-        0x00,
-        SET_COM_PIN_CFG,
-        width > 2 * height ? 0x02 : 0x12,
-        // timing and driving scheme
-        SET_DISP_CLK_DIV,
-        0x80,
-        SET_PRECHARGE,
-        p->external_vcc ? 0x22 : 0xF1,
-        SET_VCOM_DESEL,
-        0x30, // 0.83*Vcc
-        // display
-        SET_CONTRAST,
-        0xFF,          // maximum
-        SET_ENTIRE_ON, // output follows RAM contents
-        SET_NORM_INV,  // not inverted
-        // charge pump
-        SET_CHARGE_PUMP,
-        p->external_vcc ? 0x10 : 0x14,
-        SET_DISP | 0x01};
-
-    for (size_t i = 0; i < sizeof(cmds); ++i)
-        ssd1306_write(p, cmds[i]);
+    if ((p->shadow = malloc(p->bufsize)) == NULL)
+    {
+        free(p->buffer - 1);
+        p->bufsize = 0;
+        return false;
+    }
+    p->shadow_valid = false;
+    ssd1306_clear(p);
+
+    // worst case for asynchronous show is one window per page
+    p->tx_capacity = p->pages * (p->width + 8);
+    p->tx_words = NULL;
+    p->dma_chan = -1;
+    p->joystick_background.pages = NULL;
+    p->joystick_background.size = 0;
+
+    uint8_t cmds[sizeof(ssd1306_init_cmds)];
+    memcpy(cmds, ssd1306_init_cmds, sizeof(cmds));
+    cmds[INIT_MUX_RATIO] = height - 1;
+    cmds[INIT_COM_PIN_CFG] = width > 2 * height ? 0x02 : 0x12;
+    cmds[INIT_PRECHARGE] = p->external_vcc ? 0x22 : 0xF1;
+    cmds[INIT_CHARGE_PUMP] = p->external_vcc ? 0x10 : 0x14;
+
+    ssd1306_i2c_write(p, cmds, sizeof(cmds), "ssd1306_init");
 
     return true;
 }
 
 inline void ssd1306_deinit(ssd1306_t *p)
 {
+    while (ssd1306_busy(p))
+    {
+    }
     free(p->buffer - 1);
+    free(p->shadow);
+    free(p->tx_words);
+    free(p->joystick_background.pages);
+    if (p->dma_chan >= 0)
+        dma_channel_unclaim(p->dma_chan);
 }
 
 inline void ssd1306_poweroff(ssd1306_t *p)
@@ -144,8 +225,8 @@ inline void ssd1306_poweron(ssd1306_t *p)
 
 inline void ssd1306_contrast(ssd1306_t *p, uint8_t val)
 {
-    ssd1306_write(p, SET_CONTRAST);
-    ssd1306_write(p, val);
+    const uint8_t cmds[] = {SET_CONTRAST, val};
+    ssd1306_write_cmds(p, cmds, sizeof(cmds));
 }
 
 inline void ssd1306_invert(ssd1306_t *p, uint8_t inv)
@@ -153,9 +234,17 @@ inline void ssd1306_invert(ssd1306_t *p, uint8_t inv)
     ssd1306_write(p, SET_NORM_INV | (inv & 1));
 }
 
+static inline void ssd1306_reset_dirty(ssd1306_t *p, uint8_t page)
+{
+    p->dirty_min[page] = 0xFF;
+    p->dirty_max[page] = 0;
+}
+
 inline void ssd1306_clear(ssd1306_t *p)
 {
     memset(p->buffer, 0, p->bufsize);
+    for (uint8_t page = 0; page < p->pages; ++page)
+        ssd1306_mark_dirty(p, page, 0, p->width - 1);
 }
 
 void ssd1306_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y)
@@ -164,39 +253,127 @@ void ssd1306_draw_pixel(ssd1306_t *p, uint32_t x, uint32_t y)
         return;
 
     p->buffer[x + p->width * (y >> 3)] |= 0x1 << (y & 0x07); // y>>3==y/8 && y&0x7==y%8
+    ssd1306_mark_dirty(p, y >> 3, x, x);
+}
+
+// clip a span [from, to] to [0, limit), returns false if nothing is left
+static inline bool ssd1306_clip_span(int32_t *from, int32_t *to, int32_t limit)
+{
+    if (*from > *to)
+        swap(from, to);
+    if (*to < 0 || *from >= limit)
+        return false;
+    if (*from < 0)
+        *from = 0;
+    if (*to >= limit)
+        *to = limit - 1;
+    return true;
 }
 
 void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
 {
-    if (x1 > x2)
+    if (y1 == y2)
     {
-        swap(&x1, &x2);
-        swap(&y1, &y2);
+        // horizontal: one masked OR per column within a single page
+        if (y1 < 0 || y1 >= p->height || !ssd1306_clip_span(&x1, &x2, p->width))
+            return;
+        ssd1306_draw_square(p, x1, y1, x2 - x1 + 1, 1);
+        return;
     }
 
     if (x1 == x2)
     {
-        if (y1 > y2)
-            swap(&y1, &y2);
-        for (int32_t i = y1; i <= y2; ++i)
-            ssd1306_draw_pixel(p, x1, i);
+        // vertical: whole page bytes, masked at both ends
+        if (x1 < 0 || x1 >= p->width || !ssd1306_clip_span(&y1, &y2, p->height))
+            return;
+        ssd1306_draw_square(p, x1, y1, 1, y2 - y1 + 1);
         return;
     }
 
-    float m = (float)(y2 - y1) / (float)(x2 - x1);
+    const int32_t dx = abs(x2 - x1);
+    const int32_t dy = -abs(y2 - y1);
+    const int32_t sx = x1 < x2 ? 1 : -1;
+    const int32_t sy = y1 < y2 ? 1 : -1;
+    int32_t err = dx + dy;
 
-    for (int32_t i = x1; i <= x2; ++i)
+    while (1)
     {
-        float y = m * (float)(i - x1) + (float)y1;
-        ssd1306_draw_pixel(p, i, (uint32_t)y);
+        ssd1306_draw_pixel(p, x1, y1);
+        if (x1 == x2 && y1 == y2)
+            break;
+
+        const int32_t e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y1 += sy;
+        }
     }
 }
 
 void ssd1306_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
 {
-    for (uint32_t i = 0; i < width; ++i)
-        for (uint32_t j = 0; j < height; ++j)
-            ssd1306_draw_pixel(p, x + i, y + j);
+    if (x >= p->width || y >= p->height || width == 0 || height == 0)
+        return;
+    if (width > p->width - x)
+        width = p->width - x;
+    if (height > p->height - y)
+        height = p->height - y;
+
+    const uint32_t first_page = y >> 3;
+    const uint32_t last_page = (y + height - 1) >> 3;
+
+    for (uint32_t page = first_page; page <= last_page; ++page)
+    {
+        uint8_t mask = 0xFF;
+        if (page == first_page)
+            mask &= 0xFF << (y & 7);
+        if (page == last_page)
+            mask &= 0xFF >> (7 - ((y + height - 1) & 7));
+
+        uint8_t *row = p->buffer + page * p->width + x;
+        for (uint32_t i = 0; i < width; ++i)
+            row[i] |= mask;
+
+        ssd1306_mark_dirty(p, page, x, x + width - 1);
+    }
+}
+
+void ssd1306_draw_column(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t bits, uint32_t height)
+{
+    if (x >= p->width || y >= p->height || height == 0)
+        return;
+    if (height > 32)
+        height = 32;
+    if (height > p->height - y)
+        height = p->height - y;
+    if (height < 32)
+        bits &= (1u << height) - 1;
+
+    uint32_t page = y >> 3;
+    const uint32_t shift = y & 7;
+    uint8_t *dst = p->buffer + page * p->width + x;
+
+    *dst |= (uint8_t)(bits << shift);
+    ssd1306_mark_dirty(p, page, x, x);
+
+    // bits left over for the following pages
+    int32_t remaining = (int32_t)height - (int32_t)(8 - shift);
+    bits >>= 8 - shift;
+    while (remaining > 0)
+    {
+        dst += p->width;
+        ++page;
+        *dst |= (uint8_t)bits;
+        ssd1306_mark_dirty(p, page, x, x);
+        bits >>= 8;
+        remaining -= 8;
+    }
 }
 
 void ssd13606_draw_empty_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
@@ -243,14 +420,61 @@ void ssd1306_draw_circle(ssd1306_t *p, int16_t x0, int16_t y0, int16_t r)
     }
 }
 
+// glyph column bits with every bit repeated scale times, rebuilt when the scale changes
+static uint32_t expanded_columns[256];
+static uint32_t expanded_scale;
+
+static void ssd1306_expand_columns(uint32_t scale)
+{
+    const uint32_t run = (1u << scale) - 1;
+
+    for (uint32_t line = 0; line < 256; ++line)
+    {
+        uint32_t bits = 0;
+        for (uint32_t j = 0; j < 8; ++j)
+        {
+            if (line & (1u << j))
+                bits |= run << (j * scale);
+        }
+        expanded_columns[line] = bits;
+    }
+    expanded_scale = scale;
+}
+
 void ssd1306_draw_char_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const uint8_t *font, char c)
 {
     if (c > '~')
         return;
 
+    const uint8_t *glyph = &font[(c - 0x20) * font[1] + 2];
+
+    if (scale == 1)
+    {
+        // one or two page byte ORs per column
+        for (uint8_t i = 0; i < font[1]; ++i)
+            ssd1306_draw_column(p, x + i, y, glyph[i], font[0]);
+        return;
+    }
+
+    if (scale * font[0] <= 32)
+    {
+        if (expanded_scale != scale)
+            ssd1306_expand_columns(scale);
+
+        for (uint8_t i = 0; i < font[1]; ++i)
+        {
+            uint32_t bits = expanded_columns[glyph[i]];
+            if (!bits)
+                continue;
+            for (uint32_t k = 0; k < scale; ++k)
+                ssd1306_draw_column(p, x + i * scale + k, y, bits, font[0] * scale);
+        }
+        return;
+    }
+
     for (uint8_t i = 0; i < font[1]; ++i)
     {
-        uint8_t line = (font[(c - 0x20) * font[1] + i + 2]);
+        uint8_t line = glyph[i];
 
         for (int8_t j = 0; j < font[0]; ++j, line >>= 1)
         {
@@ -348,34 +572,268 @@ inline void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long
     ssd1306_bmp_show_image_with_offset(p, data, size, 0, 0);
 }
 
-void ssd1306_show(ssd1306_t *p)
+void ssd1306_blit_page_image(ssd1306_t *p, const ssd1306_page_image_t *img, uint32_t x, uint32_t y)
 {
-    uint8_t payload[] = {SET_COL_ADDR, 0, p->width - 1, SET_PAGE_ADDR, 0, p->pages - 1};
+    if (x >= p->width || y >= p->height || img->width == 0 || img->height == 0)
+        return;
+
+    const uint32_t width = img->width < p->width - x ? img->width : p->width - x;
+    const uint32_t shift = y & 7;
+    const uint32_t src_pages = (img->height + 7) >> 3;
+    uint32_t page = y >> 3;
+
+    for (uint32_t sp = 0; sp < src_pages && page < p->pages; ++sp, ++page)
+    {
+        // rows of this source page that belong to the image
+        uint32_t rows = img->height - sp * 8;
+        const uint8_t mask = rows >= 8 ? 0xff : (uint8_t)((1u << rows) - 1);
+        const uint8_t *src = img->pages + sp * img->width;
+
+        uint8_t *dst = p->buffer + page * p->width + x;
+        const uint8_t lo_mask = (uint8_t)(mask << shift);
+        for (uint32_t i = 0; i < width; ++i)
+            dst[i] = (dst[i] & ~lo_mask) | ((uint8_t)((src[i] & mask) << shift));
+        ssd1306_mark_dirty(p, page, x, x + width - 1);
+
+        if (shift == 0 || page + 1 >= p->pages)
+            continue;
+
+        // upper rows spill into the following page
+        const uint8_t hi_mask = (uint8_t)(mask >> (8 - shift));
+        if (hi_mask == 0)
+            continue;
+        dst += p->width;
+        for (uint32_t i = 0; i < width; ++i)
+            dst[i] = (dst[i] & ~hi_mask) | ((src[i] & mask) >> (8 - shift));
+        ssd1306_mark_dirty(p, page + 1, x, x + width - 1);
+    }
+}
+
+static void ssd1306_set_window(ssd1306_t *p, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    uint8_t payload[] = {0x00, SET_COL_ADDR, x0, x1, SET_PAGE_ADDR, page0, page1};
     if (p->width == 64)
     {
-        payload[1] += 32;
         payload[2] += 32;
+        payload[3] += 32;
     }
 
-    for (size_t i = 0; i < sizeof(payload); ++i)
-        ssd1306_write(p, payload[i]);
+    ssd1306_i2c_write(p, payload, sizeof(payload), "ssd1306_set_window");
+}
 
-    *(p->buffer - 1) = 0x40;
+// narrow the touched columns of a page to the span that differs from the display RAM
+static bool ssd1306_dirty_span(ssd1306_t *p, uint8_t page, uint8_t *x0, uint8_t *x1)
+{
+    if (p->dirty_min[page] > p->dirty_max[page])
+        return false;
+
+    const uint8_t *row = p->buffer + page * p->width;
+    const uint8_t *shadow = p->shadow + page * p->width;
+    int32_t start = p->dirty_min[page];
+    int32_t end = p->dirty_max[page];
 
-    fancy_write(p->i2c_i, p->address, p->buffer - 1, p->bufsize + 1, "ssd1306_show");
+    while (start <= end && row[start] == shadow[start])
+        ++start;
+    while (end >= start && row[end] == shadow[end])
+        --end;
+
+    ssd1306_reset_dirty(p, page);
+    if (start > end)
+        return false;
+
+    *x0 = (uint8_t)start;
+    *x1 = (uint8_t)end;
+    return true;
+}
+
+void ssd1306_show(ssd1306_t *p)
+{
+    ssd1306_wait_idle(p);
+
+    if (!p->shadow_valid)
+    {
+        ssd1306_set_window(p, 0, p->width - 1, 0, p->pages - 1);
+
+        *(p->buffer - 1) = 0x40;
+
+        ssd1306_i2c_write(p, p->buffer - 1, p->bufsize + 1, "ssd1306_show");
+
+        memcpy(p->shadow, p->buffer, p->bufsize);
+        p->shadow_valid = true;
+        for (uint8_t page = 0; page < p->pages; ++page)
+            ssd1306_reset_dirty(p, page);
+        return;
+    }
+
+    for (uint8_t page = 0; page < p->pages; ++page)
+    {
+        uint8_t x0, x1;
+        if (!ssd1306_dirty_span(p, page, &x0, &x1))
+            continue;
+
+        ssd1306_set_window(p, x0, x1, page, page);
+
+        // the byte in front of the span temporarily holds the data control byte
+        uint8_t *span = p->buffer + page * p->width + x0;
+        uint8_t saved = *(span - 1);
+        *(span - 1) = 0x40;
+        ssd1306_i2c_write(p, span - 1, x1 - x0 + 2, "ssd1306_show");
+        *(span - 1) = saved;
+
+        memcpy(p->shadow + page * p->width + x0, span, x1 - x0 + 1);
+    }
+}
+
+// one I2C transaction per window for commands, restart, then one for the data
+static size_t ssd1306_push_window(ssd1306_t *p, size_t n, uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1, const uint8_t *data, size_t len)
+{
+    uint8_t col_offset = p->width == 64 ? 32 : 0;
+    uint16_t *w = p->tx_words;
+    uint16_t restart = n > 0 ? I2C_IC_DATA_CMD_RESTART_BITS : 0;
+
+    w[n++] = 0x00 | restart;
+    w[n++] = SET_COL_ADDR;
+    w[n++] = x0 + col_offset;
+    w[n++] = x1 + col_offset;
+    w[n++] = SET_PAGE_ADDR;
+    w[n++] = page0;
+    w[n++] = page1;
+    w[n++] = 0x40 | I2C_IC_DATA_CMD_RESTART_BITS;
+    for (size_t i = 0; i < len; ++i)
+        w[n++] = data[i];
+
+    return n;
+}
+
+bool ssd1306_busy(ssd1306_t *p)
+{
+    if (p->dma_chan < 0)
+        return false;
+
+    i2c_hw_t *hw = i2c_get_hw(p->i2c_i);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS)
+    {
+        // display did not acknowledge, the rest of the stream is flushed by the controller
+        dma_channel_abort(p->dma_chan);
+        (void)hw->clr_tx_abrt;
+        p->shadow_valid = false;
+        ssd1306_slow_down(p);
+        return false;
+    }
+
+    if (dma_channel_is_busy(p->dma_chan))
+        return true;
+
+    return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+bool ssd1306_show_async(ssd1306_t *p)
+{
+    if (p->dma_chan < 0)
+    {
+        if ((p->tx_words = malloc(p->tx_capacity * sizeof(uint16_t))) == NULL)
+        {
+            ssd1306_show(p);
+            return true;
+        }
+        p->dma_chan = dma_claim_unused_channel(true);
+    }
+
+    if (ssd1306_busy(p))
+        return false;
+
+    size_t n = 0;
+    if (!p->shadow_valid)
+    {
+        n = ssd1306_push_window(p, n, 0, p->width - 1, 0, p->pages - 1, p->buffer, p->bufsize);
+        memcpy(p->shadow, p->buffer, p->bufsize);
+        p->shadow_valid = true;
+        for (uint8_t page = 0; page < p->pages; ++page)
+            ssd1306_reset_dirty(p, page);
+    }
+    else
+    {
+        for (uint8_t page = 0; page < p->pages; ++page)
+        {
+            uint8_t x0, x1;
+            if (!ssd1306_dirty_span(p, page, &x0, &x1))
+                continue;
+
+            const uint8_t *span = p->buffer + page * p->width + x0;
+            n = ssd1306_push_window(p, n, x0, x1, page, page, span, x1 - x0 + 1);
+            memcpy(p->shadow + page * p->width + x0, span, x1 - x0 + 1);
+        }
+    }
+
+    if (n == 0)
+        return true;
+
+    p->tx_words[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    i2c_hw_t *hw = i2c_get_hw(p->i2c_i);
+    hw->enable = 0;
+    hw->tar = p->address;
+    hw->enable = 1;
+
+    dma_channel_config c = dma_channel_get_default_config(p->dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(p->i2c_i, true));
+    dma_channel_configure(p->dma_chan, &c, &hw->data_cmd, p->tx_words, n, true);
+
+    return true;
 }
 
 uint16_t map_range(uint16_t input, uint16_t input_start, uint16_t input_end, uint16_t output_start, uint16_t output_end)
 {
-    double slope = 1.0 * (output_end - output_start) / (input_end - input_start);
-    uint16_t output = (uint16_t)round(output_start + slope * (input - input_start));
+    // integer rounding to nearest, 16 bit ranges keep the product in 32 bits and there is no FPU
+    const uint32_t in_range = (uint32_t)(input_end - input_start);
+    const uint32_t offset = (uint32_t)(input - input_start);
+    if (in_range == 0)
+        return output_start;
+
+    if (output_end >= output_start)
+        return output_start + (offset * (uint32_t)(output_end - output_start) + in_range / 2) / in_range;
+    return output_start - (offset * (uint32_t)(output_start - output_end) + in_range / 2) / in_range;
+}
+
+bool ssd1306_layer_capture(ssd1306_t *p, ssd1306_layer_t *layer)
+{
+    if (layer->pages == NULL || layer->size != p->bufsize)
+    {
+        free(layer->pages);
+        if ((layer->pages = malloc(p->bufsize)) == NULL)
+        {
+            layer->size = 0;
+            return false;
+        }
+        layer->size = p->bufsize;
+    }
 
-    return output;
+    memcpy(layer->pages, p->buffer, p->bufsize);
+    return true;
 }
 
-void ssd1306_update_display(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t yawPos)
+void ssd1306_layer_restore(ssd1306_t *p, const ssd1306_layer_t *layer)
+{
+    if (layer->size != p->bufsize)
+        return;
+
+    for (uint8_t page = 0; page < p->pages; ++page)
+    {
+        uint8_t *row = p->buffer + page * p->width;
+        const uint8_t *src = layer->pages + page * p->width;
+        if (memcmp(row, src, p->width) == 0)
+            continue;
+
+        memcpy(row, src, p->width);
+        ssd1306_mark_dirty(p, page, 0, p->width - 1);
+    }
+}
+
+static void ssd1306_draw_joystick_background(ssd1306_t *p)
 {
-    // Clear the buffer
     ssd1306_clear(p);
 
     ssd13606_draw_empty_square(p, 0, 0, 64, 64);
@@ -383,31 +841,42 @@ void ssd1306_update_display(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t
     ssd1306_draw_line(p, 31, 0, 31, 63);
     // y axis
     ssd1306_draw_line(p, 0, 31, 63, 31);
-    // current jostick position
-    uint16_t x = map_range(xPos, 0, 65535, 0, 63);
-    uint16_t y = map_range(yPos, 0, 65535, 0, 63);
-    ssd1306_draw_circle(p, x, y, 3);
-    
 
     // rudder
     ssd1306_draw_line(p, 95, 0, 95, 63);
     ssd1306_draw_line(p, 90, 0, 99, 0);
     ssd1306_draw_line(p, 90, 63, 99, 63);
     ssd1306_draw_line(p, 90, 31, 99, 31);
-    uint16_t ry = map_range(yawPos, 0, 1023, 0, 63);
-    ssd1306_draw_circle(p, 95, ry, 3);
+}
 
-    ssd1306_show(p); // Update screen with each newly-drawn line
+void ssd1306_draw_joystick(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t yawPos)
+{
+    ssd1306_draw_joystick_at(p, map_range(xPos, 0, 65535, 0, 63), map_range(yPos, 0, 65535, 0, 63),
+                             map_range(yawPos, 0, 1023, 0, 63));
 }
 
-void ssd1306_debug_values(ssd1306_t *p, int16_t x, int16_t y)
+void ssd1306_draw_joystick_at(ssd1306_t *p, uint16_t x, uint16_t y, uint16_t ry)
 {
-    ssd1306_clear(p);
-    
-    char str[10];
-    sprintf(str, "%d", x);
-    ssd1306_draw_string(p, 10, 10, 1, str);
-    sprintf(str, "%d", y);
-    ssd1306_draw_string(p, 10, 20, 1, str);
-    ssd1306_show(p);
-}
\ No newline at end of file
+    if (p->joystick_background.pages == NULL)
+    {
+        ssd1306_draw_joystick_background(p);
+        ssd1306_layer_capture(p, &p->joystick_background);
+    }
+
+    if (p->joystick_background.pages != NULL)
+        ssd1306_layer_restore(p, &p->joystick_background);
+    else
+        ssd1306_draw_joystick_background(p);
+
+    // current jostick position
+    ssd1306_draw_circle(p, x, y, 3);
+
+    // rudder
+    ssd1306_draw_circle(p, 95, ry, 3);
+}
+
+void ssd1306_update_display(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t yawPos)
+{
+    ssd1306_draw_joystick(p, xPos, yPos, yawPos);
+    ssd1306_show(p); // Update screen with each newly-drawn line
+}
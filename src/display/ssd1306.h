@@ -61,6 +61,36 @@ typedef enum {
     SET_CHARGE_PUMP = 0x8D
 } ssd1306_command_t;
 
+#define SSD1306_MAX_PAGES 8
+
+/** default font, height 8 and width 5 */
+extern const uint8_t font_8x5[];
+
+/** longest command list sent by ssd1306_write_cmds */
+#define SSD1306_MAX_CMDS 32
+
+/** I2C clock in Fast-mode, used when Fast-mode Plus is off or the panel NAKs at 1 MHz */
+#define SSD1306_I2C_BAUDRATE (400 * 1000)
+/** I2C clock in Fast-mode Plus, needs strong external pull-ups */
+#define SSD1306_I2C_BAUDRATE_FAST_PLUS (1000 * 1000)
+
+/**
+*	@brief prerendered page buffer for retained static content
+*/
+typedef struct {
+    uint8_t *pages;		/**< page ordered pixels, same layout as ssd1306_t::buffer */
+    size_t size;		/**< size of pages in bytes */
+} ssd1306_layer_t;
+
+/**
+*	@brief bitmap stored in display page order, see bmp2pages.py
+*/
+typedef struct {
+    uint8_t width;			/**< width in pixels */
+    uint8_t height;			/**< height in pixels */
+    const uint8_t *pages;	/**< (height + 7) / 8 pages of width bytes, bit 0 is the top row */
+} ssd1306_page_image_t;
+
 /**
 *	@brief holds the configuration
 */
@@ -73,8 +103,29 @@ typedef struct {
     bool external_vcc; 	/**< whether display uses external vcc */ 
     uint8_t *buffer;	/**< display buffer */
     size_t bufsize;		/**< buffer size */
+    uint8_t *shadow;	/**< display RAM contents as last transmitted */
+    bool shadow_valid;	/**< whether shadow matches the display RAM */
+    uint8_t dirty_min[SSD1306_MAX_PAGES];	/**< first touched column per page */
+    uint8_t dirty_max[SSD1306_MAX_PAGES];	/**< last touched column per page, page is clean if below dirty_min */
+    uint16_t *tx_words;	/**< I2C command stream of the asynchronous transfer in flight */
+    size_t tx_capacity;	/**< size of tx_words in words */
+    int dma_chan;		/**< DMA channel of asynchronous transfers, -1 until first use */
+    ssd1306_layer_t joystick_background;	/**< static part of the joystick screen, rendered on first use */
+    uint baudrate;		/**< current I2C clock */
 } ssd1306_t;
 
+/**
+*	@brief send a list of commands in one I2C transaction
+*
+*	@param[in] p : instance of display
+*	@param[in] cmds : command bytes including their arguments
+*	@param[in] len : number of bytes, at most SSD1306_MAX_CMDS
+*
+*	@return bool.
+*	@retval false if the list is too long or the display did not acknowledge
+*/
+bool ssd1306_write_cmds(ssd1306_t *p, const uint8_t *cmds, size_t len);
+
 /**
 *	@brief turn off display
 *
@@ -129,11 +180,55 @@ void ssd1306_invert(ssd1306_t *p, uint8_t inv);
 /**
 	@brief display buffer, should be called on change
 
+	Only columns touched since the last call and actually different from the
+	display RAM are transmitted, one column/page window per dirty page.
+
 	@param[in] p : instance of display
 
 */
 void ssd1306_show(ssd1306_t *p);
 
+/**
+	@brief start transmitting changed regions of buffer without blocking
+
+	The changed bytes are copied into a separate transfer buffer that DMA feeds
+	to the I2C controller, so drawing the next frame can start right away.
+	Dirty regions are kept for the next call if a transfer is still in flight.
+
+	@param[in] p : instance of display
+
+	@return bool.
+	@retval true if a transfer was started or nothing had to be sent
+	@retval false if the previous transfer is still in flight
+*/
+bool ssd1306_show_async(ssd1306_t *p);
+
+/**
+	@brief check for an asynchronous transfer in flight
+
+	@param[in] p : instance of display
+
+	@return bool.
+	@retval true while ssd1306_show_async data is still being sent
+*/
+bool ssd1306_busy(ssd1306_t *p);
+
+/**
+	@brief mark a column range of one page as changed, for code writing p->buffer directly
+
+	@param[in] p : instance of display
+	@param[in] page : page index
+	@param[in] x0 : first column
+	@param[in] x1 : last column
+*/
+static inline void ssd1306_mark_dirty(ssd1306_t *p, uint8_t page, uint8_t x0, uint8_t x1)
+{
+    if (x0 < p->dirty_min[page])
+        p->dirty_min[page] = x0;
+    if (x1 > p->dirty_max[page])
+        p->dirty_max[page] = x1;
+}
+
 /**
 	@brief clear display buffer
 
@@ -173,6 +268,20 @@ void ssd1306_draw_line(ssd1306_t *p, int32_t x1, int32_t y1, int32_t x2, int32_t
 */
 void ssd1306_draw_square(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
 
+/**
+	@brief OR a vertical run of up to 32 pixels into the buffer
+
+	Bit 0 of bits lands on y. Writes whole page bytes, so a page aligned run
+	of 8 pixels costs a single byte OR.
+
+	@param[in] p : instance of display
+	@param[in] x : x position of column
+	@param[in] y : y position of first pixel
+	@param[in] bits : pixels to set, LSB first
+	@param[in] height : number of pixels in bits
+*/
+void ssd1306_draw_column(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t bits, uint32_t height);
+
 /**
 	@brief draw empty square at given position with given size
 
@@ -204,6 +313,19 @@ void ssd1306_bmp_show_image_with_offset(ssd1306_t *p, const uint8_t *data, const
 */
 void ssd1306_bmp_show_image(ssd1306_t *p, const uint8_t *data, const long size);
 
+/**
+	@brief copy a page ordered image into the buffer
+
+	Pixels inside the image rectangle are replaced, pixels around it are kept.
+	Images at a y offset that is not a multiple of 8 are shifted across two pages.
+
+	@param[in] p : instance of display
+	@param[in] img : image, usually generated from images/ at build time
+	@param[in] x : x offset of the image
+	@param[in] y : y offset of the image
+*/
+void ssd1306_blit_page_image(ssd1306_t *p, const ssd1306_page_image_t *img, uint32_t x, uint32_t y);
+
 /**
 	@brief draw char with given font
 
@@ -250,6 +372,63 @@ void ssd1306_draw_string_with_font(ssd1306_t *p, uint32_t x, uint32_t y, uint32_
 */
 void ssd1306_draw_string(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const char *s);
 
+/**
+	@brief copy current buffer into a layer, allocating the layer on first use
+
+	@param[in] p : instance of display
+	@param[in] layer : layer to fill
+
+	@return bool.
+	@retval false if the layer could not be allocated
+*/
+bool ssd1306_layer_capture(ssd1306_t *p, ssd1306_layer_t *layer);
+
+/**
+	@brief replace buffer contents with a layer
+
+	Only pages that differ from the layer are copied and marked dirty.
+
+	@param[in] p : instance of display
+	@param[in] layer : layer captured from a display of the same size
+*/
+void ssd1306_layer_restore(ssd1306_t *p, const ssd1306_layer_t *layer);
+
+/**
+	@brief draw joystick position screen into buffer without showing it
+
+	The box, crosshair and rudder scale are drawn once into a cached
+	background layer, afterwards a frame is a layer restore plus the cursors.
+
+	@param[in] p : instance of display
+	@param[in] xPos : joystick x position
+	@param[in] yPos : joystick y position
+	@param[in] yawPos : joystick yaw position
+*/
+void ssd1306_draw_joystick(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t yawPos);
+
+/**
+	@brief draw joystick position screen with cursors already in screen coordinates
+
+	@param[in] p : instance of display
+	@param[in] x : stick cursor column, 0 - 63
+	@param[in] y : stick cursor row, 0 - 63
+	@param[in] ry : rudder cursor row, 0 - 63
+*/
+void ssd1306_draw_joystick_at(ssd1306_t *p, uint16_t x, uint16_t y, uint16_t ry);
+
+/**
+	@brief map input range to output range, used for on screen cursor positions
+
+	@param[in] input : value to map
+	@param[in] input_start : lower end of input range
+	@param[in] input_end : upper end of input range
+	@param[in] output_start : lower end of output range
+	@param[in] output_end : upper end of output range
+
+	@return mapped value
+*/
+uint16_t map_range(uint16_t input, uint16_t input_start, uint16_t input_end, uint16_t output_start, uint16_t output_end);
+
 /**
 	@brief show joystick position on display
 
@@ -270,8 +449,6 @@ void ssd1306_update_display(ssd1306_t *p, uint16_t xPos, uint16_t yPos, uint16_t
 */
 void ssd1306_draw_circle(ssd1306_t *p, int16_t x0, int16_t y0, int16_t r);
 
-void ssd1306_debug_values(ssd1306_t *p, int16_t x, int16_t y);
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,94 @@
+#include <string.h>
+
+#include "ssd1306_graph.h"
+
+// replace a vertical run of up to 64 pixels, bit 0 lands on y
+static void put_column(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t height, uint64_t bits)
+{
+    if (x >= p->width || y >= p->height)
+        return;
+    if (height > p->height - y)
+        height = p->height - y;
+
+    const uint32_t shift = y & 7;
+    uint64_t mask = height < 64 ? ((uint64_t)1 << height) - 1 : ~(uint64_t)0;
+    bits = (bits & mask) << shift;
+    mask <<= shift;
+
+    for (uint32_t page = y >> 3; mask && page < p->pages; ++page, mask >>= 8, bits >>= 8)
+    {
+        uint8_t *dst = p->buffer + page * p->width + x;
+        *dst = (*dst & ~(uint8_t)mask) | (uint8_t)bits;
+        ssd1306_mark_dirty(p, page, x, x);
+    }
+}
+
+// row of a value, the top row is the maximum
+static uint32_t value_row(const ssd1306_graph_t *g, uint8_t trace, int32_t value)
+{
+    uint32_t offset = value <= g->min[trace] ? 0 : (uint32_t)value - (uint32_t)g->min[trace];
+    if (offset > g->range[trace])
+        offset = g->range[trace];
+
+    // offset * row_scale stays below (height - 1) << 16
+    return g->height - 1 - ((offset * g->row_scale[trace] + 0x8000) >> 16);
+}
+
+void ssd1306_graph_init(ssd1306_graph_t *g, uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    memset(g, 0, sizeof(*g));
+    g->x = x;
+    g->y = y;
+    g->width = width < 2 ? 2 : width;
+    g->height = height > 64 ? 64 : height < 1 ? 1 : height;
+}
+
+void ssd1306_graph_set_trace(ssd1306_graph_t *g, uint8_t trace, int32_t min, int32_t max)
+{
+    if (trace >= SSD1306_GRAPH_MAX_TRACES || max < min)
+        return;
+
+    g->min[trace] = min;
+    g->range[trace] = (uint32_t)max - (uint32_t)min;
+    g->row_scale[trace] = g->range[trace] ? (uint32_t)(((uint64_t)(g->height - 1) << 16) / g->range[trace]) : 0;
+    if (g->traces <= trace)
+        g->traces = trace + 1;
+    g->has_last = false;
+}
+
+void ssd1306_graph_clear(ssd1306_t *p, ssd1306_graph_t *g)
+{
+    for (uint32_t i = 0; i < g->width; ++i)
+        put_column(p, g->x + i, g->y, g->height, 0);
+    g->cursor = 0;
+    g->has_last = false;
+}
+
+void ssd1306_graph_push(ssd1306_t *p, ssd1306_graph_t *g, const int32_t *values)
+{
+    uint64_t bits = 0;
+
+    for (uint8_t t = 0; t < g->traces; ++t)
+    {
+        uint32_t row = value_row(g, t, values[t]);
+        uint32_t lo = row, hi = row;
+
+        // connect to the previous sample so fast moves stay visible
+        if (g->has_last)
+        {
+            if (g->last_row[t] < lo)
+                lo = g->last_row[t];
+            if (g->last_row[t] > hi)
+                hi = g->last_row[t];
+        }
+
+        bits |= (((uint64_t)2 << (hi - lo)) - 1) << lo;
+        g->last_row[t] = row;
+    }
+    g->has_last = true;
+
+    put_column(p, g->x + g->cursor, g->y, g->height, bits);
+
+    g->cursor = g->cursor + 1 < g->width ? g->cursor + 1 : 0;
+    put_column(p, g->x + g->cursor, g->y, g->height, 0);
+}
@@ -0,0 +1,81 @@
+/**
+* @file ssd1306_graph.h
+*
+* rolling time series plot that renders one column per sample
+*/
+
+#ifndef _tmext_inc_ssd1306_graph
+#define _tmext_inc_ssd1306_graph
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ssd1306.h"
+
+#define SSD1306_GRAPH_MAX_TRACES 4
+
+/**
+*	@brief sweeping plot inside a rectangle of the display
+*
+*	The write position moves right by one column per sample and wraps around.
+*	The column ahead of it is kept blank to mark the sweep, so a sample only
+*	dirties two columns and ssd1306_show sends a two column window per page.
+*/
+typedef struct {
+    uint8_t x;			/**< left edge of the plot */
+    uint8_t y;			/**< top edge of the plot */
+    uint8_t width;		/**< columns, at least 2 */
+    uint8_t height;		/**< rows, at most 64 */
+    uint8_t cursor;		/**< column written by the next sample */
+    uint8_t traces;		/**< number of configured traces */
+    uint8_t last_row[SSD1306_GRAPH_MAX_TRACES];	/**< row of the previous sample, connects the trace */
+    bool has_last;		/**< whether last_row holds a sample */
+    int32_t min[SSD1306_GRAPH_MAX_TRACES];		/**< value shown on the bottom row */
+    uint32_t range[SSD1306_GRAPH_MAX_TRACES];	/**< max - min */
+    uint32_t row_scale[SSD1306_GRAPH_MAX_TRACES];	/**< rows per value step, 16.16 fixed point */
+} ssd1306_graph_t;
+
+/**
+	@brief set up a graph without traces
+
+	@param[in] g : graph
+	@param[in] x : left edge
+	@param[in] y : top edge
+	@param[in] width : columns
+	@param[in] height : rows, clamped to 64
+*/
+void ssd1306_graph_init(ssd1306_graph_t *g, uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+
+/**
+	@brief set the value range of a trace, traces up to index are enabled
+
+	@param[in] g : graph
+	@param[in] trace : index below SSD1306_GRAPH_MAX_TRACES
+	@param[in] min : value on the bottom row
+	@param[in] max : value on the top row, values outside are clamped
+*/
+void ssd1306_graph_set_trace(ssd1306_graph_t *g, uint8_t trace, int32_t min, int32_t max);
+
+/**
+	@brief clear the plot area and restart at the left edge
+
+	@param[in] p : instance of display
+	@param[in] g : graph
+*/
+void ssd1306_graph_clear(ssd1306_t *p, ssd1306_graph_t *g);
+
+/**
+	@brief add one sample of every trace and render its column
+
+	@param[in] p : instance of display
+	@param[in] g : graph
+	@param[in] values : one value per configured trace
+*/
+void ssd1306_graph_push(ssd1306_t *p, ssd1306_graph_t *g, const int32_t *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_inc_ssd1306_graph */
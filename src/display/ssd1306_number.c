@@ -0,0 +1,141 @@
+#include <string.h>
+
+#include "ssd1306_number.h"
+
+// characters a readout can show, the cache holds them in this order
+static const char cached_chars[] = " -#0123456789";
+#define CACHED_CHARS (sizeof(cached_chars) - 1)
+
+// font_8x5 glyphs are 5 columns of 8 rows
+#define GLYPH_COLUMNS 5
+#define GLYPH_ROWS 8
+
+// glyph columns stretched vertically per scale, built on first use of a scale
+static uint32_t glyph_cache[SSD1306_NUMBER_MAX_SCALE][CACHED_CHARS][GLYPH_COLUMNS];
+static bool glyph_cache_built[SSD1306_NUMBER_MAX_SCALE];
+
+static uint32_t cached_index(char c)
+{
+    switch (c)
+    {
+    case ' ':
+        return 0;
+    case '-':
+        return 1;
+    case '#':
+        return 2;
+    default:
+        return 3 + (c - '0');
+    }
+}
+
+static void build_glyph_cache(uint8_t scale)
+{
+    const uint32_t run = (1u << scale) - 1;
+
+    for (uint32_t c = 0; c < CACHED_CHARS; ++c)
+    {
+        const uint8_t *glyph = &font_8x5[(cached_chars[c] - 0x20) * GLYPH_COLUMNS + 2];
+        for (uint32_t i = 0; i < GLYPH_COLUMNS; ++i)
+        {
+            uint32_t bits = 0;
+            for (uint32_t j = 0; j < GLYPH_ROWS; ++j)
+            {
+                if (glyph[i] & (1u << j))
+                    bits |= run << (j * scale);
+            }
+            glyph_cache[scale - 1][c][i] = bits;
+        }
+    }
+    glyph_cache_built[scale - 1] = true;
+}
+
+void ssd1306_format_int(char *dst, uint8_t cells, int32_t value)
+{
+    // magnitude as unsigned so INT32_MIN does not overflow
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    int32_t i = cells - 1;
+
+    do
+    {
+        if (i < 0)
+            goto overflow;
+        dst[i--] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0)
+    {
+        if (i < 0)
+            goto overflow;
+        dst[i--] = '-';
+    }
+
+    while (i >= 0)
+        dst[i--] = ' ';
+    return;
+
+overflow:
+    memset(dst, '#', cells);
+}
+
+void ssd1306_number_init(ssd1306_number_t *n, uint8_t x, uint8_t y, uint8_t scale, uint8_t cells)
+{
+    n->x = x;
+    n->y = y;
+    n->scale = scale < 1 ? 1 : scale > SSD1306_NUMBER_MAX_SCALE ? SSD1306_NUMBER_MAX_SCALE : scale;
+    n->cells = cells > SSD1306_NUMBER_MAX_CELLS ? SSD1306_NUMBER_MAX_CELLS : cells;
+    ssd1306_number_invalidate(n);
+}
+
+void ssd1306_number_invalidate(ssd1306_number_t *n)
+{
+    memset(n->shown, 0, sizeof(n->shown));
+}
+
+// replace one cell page by page, the glyph columns are repeated scale times and the rest is spacing
+static void draw_cell(ssd1306_t *p, uint32_t x, uint32_t y, uint32_t scale, const uint32_t *columns)
+{
+    const uint32_t pitch = GLYPH_ROWS * scale;
+    if (x >= p->width || y >= p->height)
+        return;
+
+    const uint32_t width = pitch < p->width - x ? pitch : p->width - x;
+    const uint32_t glyph_width = GLYPH_COLUMNS * scale < width ? GLYPH_COLUMNS * scale : width;
+    const uint32_t shift = y & 7;
+    const uint32_t last_page = (y + pitch - 1) >> 3 < p->pages ? (y + pitch - 1) >> 3 : p->pages - 1u;
+    const uint64_t cell_mask = (((uint64_t)1 << pitch) - 1) << shift;
+
+    for (uint32_t page = y >> 3, k = 0; page <= last_page; ++page, k += 8)
+    {
+        uint8_t *dst = p->buffer + page * p->width + x;
+        const uint8_t keep = ~(uint8_t)(cell_mask >> k);
+
+        for (uint32_t i = 0; i < glyph_width; ++i)
+            dst[i] = (dst[i] & keep) | (uint8_t)(((uint64_t)columns[i / scale] << shift) >> k);
+        for (uint32_t i = glyph_width; i < width; ++i)
+            dst[i] &= keep;
+
+        ssd1306_mark_dirty(p, page, x, x + width - 1);
+    }
+}
+
+void ssd1306_number_draw(ssd1306_t *p, ssd1306_number_t *n, int32_t value)
+{
+    char text[SSD1306_NUMBER_MAX_CELLS];
+    ssd1306_format_int(text, n->cells, value);
+
+    const uint32_t scale = n->scale;
+    const uint32_t pitch = GLYPH_ROWS * scale;
+    if (!glyph_cache_built[scale - 1])
+        build_glyph_cache(scale);
+
+    for (uint32_t cell = 0; cell < n->cells; ++cell)
+    {
+        if (text[cell] == n->shown[cell])
+            continue;
+
+        draw_cell(p, n->x + cell * pitch, n->y, scale, glyph_cache[scale - 1][cached_index(text[cell])]);
+        n->shown[cell] = text[cell];
+    }
+}
@@ -0,0 +1,76 @@
+/**
+* @file ssd1306_number.h
+*
+* fixed width integer readouts that only redraw changed digit cells
+*/
+
+#ifndef _tmext_inc_ssd1306_number
+#define _tmext_inc_ssd1306_number
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ssd1306.h"
+
+/** enough cells for "-2147483648" */
+#define SSD1306_NUMBER_MAX_CELLS 11
+/** largest scale with a glyph cache, a cell column has to fit into 32 bits */
+#define SSD1306_NUMBER_MAX_SCALE 4
+
+/**
+*	@brief right aligned integer readout at a fixed position
+*/
+typedef struct {
+    uint8_t x;			/**< x position of the leftmost cell */
+    uint8_t y;			/**< y position of the top row */
+    uint8_t scale;		/**< font scale, 1 to SSD1306_NUMBER_MAX_SCALE */
+    uint8_t cells;		/**< width in characters */
+    char shown[SSD1306_NUMBER_MAX_CELLS];	/**< characters in the buffer, 0 if the cell is unknown */
+} ssd1306_number_t;
+
+/**
+	@brief format an integer right aligned into a fixed number of cells
+
+	Pads with spaces, fills every cell with '#' if the value does not fit.
+	No terminating zero is written.
+
+	@param[out] dst : cells characters
+	@param[in] cells : number of characters
+	@param[in] value : value to format
+*/
+void ssd1306_format_int(char *dst, uint8_t cells, int32_t value);
+
+/**
+	@brief set up a readout, the first draw renders every cell
+
+	@param[in] n : readout
+	@param[in] x : x position
+	@param[in] y : y position
+	@param[in] scale : font scale, clamped to 1 - SSD1306_NUMBER_MAX_SCALE
+	@param[in] cells : width in characters, clamped to SSD1306_NUMBER_MAX_CELLS
+*/
+void ssd1306_number_init(ssd1306_number_t *n, uint8_t x, uint8_t y, uint8_t scale, uint8_t cells);
+
+/**
+	@brief forget what is on screen, e.g. after ssd1306_clear
+*/
+void ssd1306_number_invalidate(ssd1306_number_t *n);
+
+/**
+	@brief draw value, cells showing the same character as before are left alone
+
+	Cells are 8 * scale pixels wide like ssd1306_draw_string and overwrite
+	whatever was under them.
+
+	@param[in] p : instance of display
+	@param[in] n : readout
+	@param[in] value : value to show
+*/
+void ssd1306_number_draw(ssd1306_t *p, ssd1306_number_t *n, int32_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_inc_ssd1306_number */
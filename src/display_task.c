@@ -0,0 +1,292 @@
+#include <string.h>
+
+#include "display_task.h"
+#include "display/ssd1306_graph.h"
+#include "display/ssd1306_number.h"
+#include "seqlock.h"
+#include "profile.h"
+#include "trace.h"
+#include "axis_scale.h"
+
+// one strip per axis, rows below a page pair boundary keep a blank separator
+#define GRAPH_STRIPS 4
+#define GRAPH_STRIP_HEIGHT 16
+
+// profile table, a header row and one 8 px row per stage: name, mean us, max us
+#define PROFILE_MEAN_X 32
+#define PROFILE_MEAN_CELLS 5
+#define PROFILE_MAX_X 80
+#define PROFILE_MAX_CELLS 6
+
+// axis readouts, one 16 px row per axis: name, value
+#define VALUES_ROWS 4
+#define VALUES_SCALE 2
+#define VALUES_X 32
+#define VALUES_CELLS 5
+
+// cursor positions in pixels, a frame is only drawn when one of them moved
+typedef struct
+{
+  uint16_t x;
+  uint16_t y;
+  uint16_t yaw;
+} joystick_screen_t;
+
+static ssd1306_t *_disp;
+static uint32_t _frame_us;
+static uint32_t _last_frame_us;
+static absolute_time_t _hold_until;
+static bool _drawn;
+static joystick_screen_t _last_screen;
+static display_task_stats_t _stats;
+
+static volatile display_mode_t _requested_mode;
+static display_mode_t _mode;
+static ssd1306_graph_t _graphs[GRAPH_STRIPS];
+static ssd1306_number_t _profile_mean[PROFILE_STAGE_COUNT];
+static ssd1306_number_t _profile_max[PROFILE_STAGE_COUNT];
+static ssd1306_number_t _values[VALUES_ROWS];
+static display_view_t _last_values;
+
+static seqlock_t _lock;
+static display_view_t _view;
+
+// input ranges onto the 64 px stick box and rudder scale
+static axis_scale_t _stick_scale;
+static axis_scale_t _rudder_scale;
+
+void display_task_init(ssd1306_t *disp, uint32_t max_fps)
+{
+  _disp = disp;
+  _drawn = false;
+  _mode = DISPLAY_TASK_DEFAULT_MODE;
+  _requested_mode = _mode;
+  memset(&_stats, 0, sizeof(_stats));
+  display_task_set_fps(max_fps);
+  _last_frame_us = time_us_32() - _frame_us;
+  _hold_until = nil_time;
+  axis_scale_init(&_stick_scale, 0, 65535, 0, 63);
+  axis_scale_init(&_rudder_scale, 0, 4095, 0, 63);
+}
+
+void display_task_hold(uint32_t duration_ms)
+{
+  _hold_until = make_timeout_time_ms(duration_ms);
+}
+
+void display_task_set_fps(uint32_t max_fps)
+{
+  _frame_us = 1000000 / (max_fps ? max_fps : 1);
+}
+
+void display_task_set_mode(display_mode_t mode)
+{
+  if (mode < DISPLAY_MODE_COUNT)
+    _requested_mode = mode;
+}
+
+display_mode_t display_task_get_mode(void)
+{
+  return _requested_mode;
+}
+
+static void enter_mode(display_mode_t mode)
+{
+  _mode = mode;
+  _drawn = false;
+
+  if (mode == DISPLAY_MODE_GRAPH)
+  {
+    static const int32_t max[GRAPH_STRIPS] = {65535, 65535, 4095, 4095};
+
+    ssd1306_clear(_disp);
+    for (uint8_t i = 0; i < GRAPH_STRIPS; ++i)
+    {
+      ssd1306_graph_init(&_graphs[i], 0, i * GRAPH_STRIP_HEIGHT, _disp->width, GRAPH_STRIP_HEIGHT - 1);
+      ssd1306_graph_set_trace(&_graphs[i], 0, 0, max[i]);
+    }
+  }
+  else if (mode == DISPLAY_MODE_PROFILE)
+  {
+    ssd1306_clear(_disp);
+    if (!profile_enabled())
+    {
+      ssd1306_draw_string(_disp, 0, 0, 1, "profiling off");
+      return;
+    }
+
+    ssd1306_draw_string(_disp, PROFILE_MEAN_X, 0, 1, "avg us");
+    ssd1306_draw_string(_disp, PROFILE_MAX_X, 0, 1, "max us");
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; ++i)
+    {
+      const uint8_t y = 8 * (i + 1);
+      ssd1306_draw_string(_disp, 0, y, 1, profile_stage_name((profile_stage_t)i));
+      ssd1306_number_init(&_profile_mean[i], PROFILE_MEAN_X, y, 1, PROFILE_MEAN_CELLS);
+      ssd1306_number_init(&_profile_max[i], PROFILE_MAX_X, y, 1, PROFILE_MAX_CELLS);
+    }
+  }
+  else if (mode == DISPLAY_MODE_VALUES)
+  {
+    static const char *const names[VALUES_ROWS] = {"X", "Y", "Z", "S"};
+
+    ssd1306_clear(_disp);
+    for (uint8_t i = 0; i < VALUES_ROWS; ++i)
+    {
+      const uint8_t y = i * 8 * VALUES_SCALE;
+      ssd1306_draw_string(_disp, 0, y, VALUES_SCALE, names[i]);
+      ssd1306_number_init(&_values[i], VALUES_X, y, VALUES_SCALE, VALUES_CELLS);
+    }
+  }
+}
+
+static void show_frame(void)
+{
+  PROFILE_BEGIN(PROFILE_DISPLAY_SHOW);
+  ssd1306_show_async(_disp);
+  PROFILE_END(PROFILE_DISPLAY_SHOW);
+  trace_event(TRACE_FRAME_END, _mode);
+  _stats.rendered++;
+}
+
+static void render_graph(const display_view_t *view)
+{
+  const int32_t values[GRAPH_STRIPS] = {view->x, view->y, view->z, view->s};
+
+  trace_event(TRACE_FRAME_BEGIN, _mode);
+  PROFILE_BEGIN(PROFILE_DISPLAY_RENDER);
+  for (uint8_t i = 0; i < GRAPH_STRIPS; ++i)
+    ssd1306_graph_push(_disp, &_graphs[i], &values[i]);
+  PROFILE_END(PROFILE_DISPLAY_RENDER);
+
+  show_frame();
+}
+
+static void render_profile(void)
+{
+  if (!profile_enabled())
+  {
+    // static text drawn by enter_mode
+    ssd1306_show_async(_disp);
+    return;
+  }
+
+  trace_event(TRACE_FRAME_BEGIN, _mode);
+  for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; ++i)
+  {
+    profile_stats_t stats;
+    profile_get((profile_stage_t)i, &stats);
+
+    const uint32_t mean = stats.count ? (uint32_t)(stats.total_cycles / stats.count) : 0;
+    ssd1306_number_draw(_disp, &_profile_mean[i], (int32_t)profile_cycles_to_us(mean));
+    ssd1306_number_draw(_disp, &_profile_max[i], (int32_t)profile_cycles_to_us(stats.max_cycles));
+  }
+
+  // the readouts only dirty changed cells, drawing them is not a stage of its own
+  show_frame();
+}
+
+static void render_values(const display_view_t *view)
+{
+  if (_drawn && memcmp(view, &_last_values, sizeof(*view)) == 0)
+  {
+    _stats.skipped++;
+    ssd1306_show_async(_disp);
+    return;
+  }
+
+  const int32_t values[VALUES_ROWS] = {view->x, view->y, view->z, view->s};
+
+  trace_event(TRACE_FRAME_BEGIN, _mode);
+  PROFILE_BEGIN(PROFILE_DISPLAY_RENDER);
+  for (uint8_t i = 0; i < VALUES_ROWS; ++i)
+    ssd1306_number_draw(_disp, &_values[i], values[i]);
+  PROFILE_END(PROFILE_DISPLAY_RENDER);
+
+  show_frame();
+  _last_values = *view;
+  _drawn = true;
+}
+
+void display_task_publish(const display_view_t *view)
+{
+  seqlock_write_begin(&_lock);
+  _view = *view;
+  seqlock_write_end(&_lock);
+}
+
+void display_task_run(void)
+{
+  if (!is_nil_time(_hold_until))
+  {
+    if (!time_reached(_hold_until))
+    {
+      ssd1306_show_async(_disp);
+      return;
+    }
+    _hold_until = nil_time;
+  }
+
+  uint32_t now = time_us_32();
+  if (now - _last_frame_us < _frame_us)
+  {
+    // use the time between frames to push what an earlier busy transfer held back
+    ssd1306_show_async(_disp);
+    return;
+  }
+  _last_frame_us = now;
+
+  display_view_t view;
+  uint32_t sequence;
+  do
+  {
+    sequence = seqlock_read_begin(&_lock);
+    view = _view;
+  } while (seqlock_read_retry(&_lock, sequence));
+
+  if (_mode != _requested_mode)
+    enter_mode(_requested_mode);
+
+  if (_mode == DISPLAY_MODE_GRAPH)
+  {
+    render_graph(&view);
+    return;
+  }
+
+  if (_mode == DISPLAY_MODE_PROFILE)
+  {
+    render_profile();
+    return;
+  }
+
+  if (_mode == DISPLAY_MODE_VALUES)
+  {
+    render_values(&view);
+    return;
+  }
+
+  joystick_screen_t screen = {
+      .x = (uint16_t)axis_scale_apply(&_stick_scale, view.x),
+      .y = (uint16_t)axis_scale_apply(&_stick_scale, view.y),
+      .yaw = (uint16_t)axis_scale_apply(&_rudder_scale, view.z)};
+
+  if (_drawn && memcmp(&screen, &_last_screen, sizeof(screen)) == 0)
+  {
+    _stats.skipped++;
+    ssd1306_show_async(_disp);
+    return;
+  }
+
+  trace_event(TRACE_FRAME_BEGIN, _mode);
+  PROFILE_BEGIN(PROFILE_DISPLAY_RENDER);
+  ssd1306_draw_joystick_at(_disp, screen.x, screen.y, screen.yaw);
+  PROFILE_END(PROFILE_DISPLAY_RENDER);
+
+  show_frame();
+  _last_screen = screen;
+  _drawn = true;
+}
+
+void display_task_get_stats(display_task_stats_t *stats)
+{
+  *stats = _stats;
+}
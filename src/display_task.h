@@ -0,0 +1,76 @@
+#ifndef _tmext_display_task_h
+#define _tmext_display_task_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "display/ssd1306.h"
+
+#ifndef DISPLAY_TASK_DEFAULT_FPS
+#define DISPLAY_TASK_DEFAULT_FPS 30
+#endif
+
+#ifndef DISPLAY_TASK_DEFAULT_MODE
+#define DISPLAY_TASK_DEFAULT_MODE DISPLAY_MODE_JOYSTICK
+#endif
+
+  typedef enum
+  {
+    DISPLAY_MODE_JOYSTICK, // stick and rudder position
+    DISPLAY_MODE_GRAPH,    // rolling plot of X, Y, Z and slider, one sample per frame
+    DISPLAY_MODE_PROFILE,  // mean and worst time per profiled stage, needs TM_PROFILE
+    DISPLAY_MODE_VALUES,   // X, Y, Z and slider as numbers
+    DISPLAY_MODE_COUNT
+  } display_mode_t;
+
+  // Input state shown on the display, same units as the joystick setters
+  typedef struct
+  {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+    int32_t s;
+  } display_view_t;
+
+  typedef struct
+  {
+    uint32_t rendered; // frames drawn and handed to ssd1306_show_async
+    uint32_t skipped;  // frame slots without a visible change
+  } display_task_stats_t;
+
+  void display_task_init(ssd1306_t *disp, uint32_t max_fps);
+
+  void display_task_set_fps(uint32_t max_fps);
+
+  /**
+   * @brief switch screens, takes effect with the next frame and is safe to call from the other core
+   */
+  void display_task_set_mode(display_mode_t mode);
+
+  display_mode_t display_task_get_mode(void);
+
+  /**
+   * @brief keep the current screen (e.g. a splash) for duration_ms before the first frame is drawn
+   */
+  void display_task_hold(uint32_t duration_ms);
+
+  /**
+   * @brief hand over the latest input state, safe to call from the other core
+   */
+  void display_task_publish(const display_view_t *view);
+
+  /**
+   * @brief render at most once per frame period, call from the loop of the core owning the display
+   */
+  void display_task_run(void);
+
+  void display_task_get_stats(display_task_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_display_task_h */
@@ -0,0 +1,207 @@
+#include "hall_sensor.h"
+#include "seqlock.h"
+#include "profile.h"
+#include "trace.h"
+#include "sof_sync.h"
+
+#if TM_SENSOR_ON_CORE1
+#include "pico/multicore.h"
+#endif
+
+// alarms closer than this are not worth it, the read starts right away
+#define SOF_MIN_DELAY_US 20
+// a read is 8 paced bytes after the chip select settle time, refined by measurement
+#define READ_TIME_INITIAL_US 3500
+
+static mlx_90333_t *_sensor;
+static mlx_90333_axis_data_t _raw;
+static volatile uint8_t _filter_shift = HALL_SENSOR_DEFAULT_FILTER_SHIFT;
+static int32_t _filtered_x;
+static int32_t _filtered_y;
+static uint32_t _valid_frames;
+static void (*_core1_task)(void);
+static void (*_sample_cb)(void);
+static uint32_t _read_start;
+static uint32_t _read_begin_us;
+static uint32_t _read_time_us = READ_TIME_INITIAL_US;
+static volatile bool _read_scheduled;
+
+static seqlock_t _lock;
+static hall_sample_t _latest;
+
+//--------------------------------------------------------------------+
+// Producer, runs on core 1 or in the core 0 alarm IRQ
+//--------------------------------------------------------------------+
+
+static void publish(const mlx_90333_axis_data_t *data)
+{
+  if (!data->valid)
+  {
+    trace_event(TRACE_SENSOR_INVALID, 0);
+    return;
+  }
+
+  int32_t x = (int32_t)data->x + 32768;
+  int32_t y = (int32_t)data->y + 32768;
+  uint8_t shift = _filter_shift;
+
+  if (_valid_frames == 0 || shift == 0)
+  {
+    _filtered_x = x;
+    _filtered_y = y;
+  }
+  else
+  {
+    _filtered_x += (x - _filtered_x) >> shift;
+    _filtered_y += (y - _filtered_y) >> shift;
+  }
+  _valid_frames++;
+
+  seqlock_write_begin(&_lock);
+  _latest.timestamp_us = time_us_32();
+  _latest.sequence = _valid_frames;
+  _latest.x = _filtered_x;
+  _latest.y = _filtered_y;
+  seqlock_write_end(&_lock);
+  trace_event(TRACE_SAMPLE_ACQUIRED, (uint16_t)_valid_frames);
+
+  if (_sample_cb)
+    _sample_cb();
+}
+
+static void read_complete_cb(const mlx_90333_axis_data_t *data, void *user_data)
+{
+  (void)user_data;
+  PROFILE_RECORD(PROFILE_SENSOR_READ, _read_start);
+
+  // follow longer reads at once and shorter ones slowly, a late read misses its frame
+  uint32_t duration = time_us_32() - _read_begin_us;
+  if (duration > _read_time_us)
+    _read_time_us = duration;
+  else
+    _read_time_us -= (_read_time_us - duration) >> 4;
+
+  publish(data);
+}
+
+static void start_read(void)
+{
+  PROFILE_STAMP(_read_start);
+  _read_begin_us = time_us_32();
+  trace_event(TRACE_SENSOR_READ_START, 0);
+  mlx90333_start_read(_sensor, &_raw, read_complete_cb, NULL);
+}
+
+#if TM_SOF_SYNC
+static int64_t sof_read_cb(alarm_id_t id, void *user_data)
+{
+  (void)id;
+  (void)user_data;
+  start_read();
+  _read_scheduled = false;
+  return 0;
+}
+
+// start the read by alarm so it completes HALL_SENSOR_SOF_GUARD_US ahead of the next reachable SOF
+static bool schedule_read(void)
+{
+  if (!sof_sync_locked())
+    return false;
+
+  const uint32_t now = time_us_32();
+  const uint32_t lead = _read_time_us + HALL_SENSOR_SOF_GUARD_US;
+  const uint32_t start = sof_sync_next(now + lead + SOF_MIN_DELAY_US) - lead;
+
+  _read_scheduled = true;
+  if (add_alarm_in_us(start - now, sof_read_cb, NULL, true) < 0)
+  {
+    // no free alarm slot
+    _read_scheduled = false;
+    return false;
+  }
+  return true;
+}
+#endif
+
+#if TM_SENSOR_ON_CORE1
+static void core1_entry(void)
+{
+  // allow core 0 to pause us while settings are written to flash
+  multicore_lockout_victim_init();
+  profile_init();
+
+  while (1)
+  {
+    PROFILE_BEGIN(PROFILE_SENSOR_READ);
+    mlx90333_get_axis_data(_sensor, &_raw);
+    PROFILE_END(PROFILE_SENSOR_READ);
+    publish(&_raw);
+
+    if (_core1_task)
+      _core1_task();
+  }
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Public API
+//--------------------------------------------------------------------+
+
+void hall_sensor_init(mlx_90333_t *sensor)
+{
+  _sensor = sensor;
+  _valid_frames = 0;
+}
+
+void hall_sensor_start(void)
+{
+#if TM_SENSOR_ON_CORE1
+  multicore_launch_core1(core1_entry);
+#endif
+}
+
+void hall_sensor_task(void)
+{
+#if !TM_SENSOR_ON_CORE1
+  if (_read_scheduled || mlx90333_poll(_sensor) == MLX90333_BUSY)
+    return;
+
+#if TM_SOF_SYNC
+  if (schedule_read())
+    return;
+#endif
+  start_read();
+#endif
+}
+
+bool hall_sensor_latest(hall_sample_t *sample)
+{
+  uint32_t sequence;
+  do
+  {
+    sequence = seqlock_read_begin(&_lock);
+    *sample = _latest;
+  } while (seqlock_read_retry(&_lock, sequence));
+
+  return sample->sequence != 0;
+}
+
+void hall_sensor_set_filter(uint8_t shift)
+{
+  _filter_shift = shift > 15 ? 15 : shift;
+}
+
+void hall_sensor_set_core1_task(void (*task)(void))
+{
+  _core1_task = task;
+}
+
+void hall_sensor_set_sample_cb(void (*callback)(void))
+{
+  _sample_cb = callback;
+}
+
+uint32_t hall_sensor_read_time_us(void)
+{
+  return _read_time_us;
+}
@@ -0,0 +1,78 @@
+#ifndef _tmext_hall_sensor_h
+#define _tmext_hall_sensor_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "mlx90333/mlx90333.h"
+
+// Default smoothing of the exponential filter, new = old + (raw - old) >> shift
+#define HALL_SENSOR_DEFAULT_FILTER_SHIFT 2
+
+// With TM_SOF_SYNC a read is timed to complete this long before a start of frame,
+// enough to take over the sample and queue the report before the host polls
+#ifndef HALL_SENSOR_SOF_GUARD_US
+#define HALL_SENSOR_SOF_GUARD_US 150
+#endif
+
+  typedef struct
+  {
+    uint32_t timestamp_us; // time the frame was completed
+    uint32_t sequence;     // number of valid frames published so far
+    int32_t x;             // filtered, 0 - 65535
+    int32_t y;             // filtered, 0 - 65535
+  } hall_sample_t;
+
+  /**
+   * @brief prepare acquisition for an already set up sensor
+   *
+   * With TM_SENSOR_ON_CORE1 acquisition and filtering run on core 1 after
+   * hall_sensor_start, otherwise hall_sensor_task drives asynchronous reads on core 0.
+   */
+  void hall_sensor_init(mlx_90333_t *sensor);
+
+  /**
+   * @brief launch core 1 acquisition, does nothing when running on core 0
+   */
+  void hall_sensor_start(void);
+
+  /**
+   * @brief keep one asynchronous frame in flight, call from the core 0 loop
+   *
+   * With TM_SOF_SYNC and a known frame phase the next read is started by an alarm
+   * instead, so that it completes HALL_SENSOR_SOF_GUARD_US before a start of frame.
+   */
+  void hall_sensor_task(void);
+
+  /**
+   * @brief invoke callback after every published sample, from the context of the producer
+   *
+   * On core 0 this is the timer IRQ, keep it short, e.g. wake a task.
+   */
+  void hall_sensor_set_sample_cb(void (*callback)(void));
+
+  // time from starting a read to its completion, longest recent one
+  uint32_t hall_sensor_read_time_us(void);
+
+  /**
+   * @brief copy the most recent filtered sample
+   *
+   * @return false if no valid frame has been read yet
+   */
+  bool hall_sensor_latest(hall_sample_t *sample);
+
+  void hall_sensor_set_filter(uint8_t shift);
+
+  /**
+   * @brief run task once per frame on core 1, set before hall_sensor_start
+   */
+  void hall_sensor_set_core1_task(void (*task)(void));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_hall_sensor_h */
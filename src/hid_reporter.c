@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include "tusb.h"
+#include "usb_descriptors.h"
+#include "hid_reporter.h"
+#include "profile.h"
+#include "trace.h"
+#include "button_events.h"
+#include "report_stage.h"
+
+static uint32_t _min_interval_us = HID_REPORTER_DEFAULT_MIN_INTERVAL_US;
+static bool _button_burst = HID_REPORTER_DEFAULT_BUTTON_BURST;
+static uint32_t _last_send_us;
+static bool _have_sent;
+static uint32_t _sample_us;
+static uint32_t _queued_sample_us;
+static bool _queued_has_sample;
+
+static hid_reporter_stats_t _stats;
+static uint32_t _window_start_us;
+static uint32_t _window_completed;
+
+// Build the current report and queue it if it differs from the last one sent
+static bool send_if_changed(void)
+{
+  uint32_t now = time_us_32();
+  bool early = false;
+
+  if (_have_sent && now - _last_send_us < _min_interval_us)
+  {
+    if (!_button_burst || !button_events_pending())
+      return false;
+    early = true;
+  }
+
+  if (!tud_hid_ready())
+    return false;
+
+  // built in place, the endpoint sends it from there
+  tm_joystick_report *report = report_stage_begin();
+  PROFILE_BEGIN(PROFILE_FILL_REPORT);
+  tm_joystick_fill_report(report);
+  PROFILE_END(PROFILE_FILL_REPORT);
+
+  const tm_joystick_report *last = report_stage_last_sent();
+  if (last && memcmp(report, last, sizeof(*report)) == 0)
+  {
+    // the host already has this state, including the newest sample
+    report_stage_discard();
+    _sample_us = 0;
+    tm_joystick_report_queued();
+    return false;
+  }
+
+  report_stage_publish();
+  if (!report_stage_send())
+    return false;
+
+  tm_joystick_report_queued();
+  if (early)
+    _stats.button_bursts++;
+  // only a report carrying a sample not reported before has an input age
+  _queued_sample_us = _sample_us;
+  _queued_has_sample = _sample_us != 0;
+  _sample_us = 0;
+  _last_send_us = now;
+  _have_sent = true;
+  _stats.reports_sent++;
+  trace_event(TRACE_REPORT_QUEUED, (uint16_t)_stats.reports_sent);
+  return true;
+}
+
+void hid_reporter_init(uint32_t min_interval_us)
+{
+  memset(&_stats, 0, sizeof(_stats));
+  _min_interval_us = min_interval_us;
+  _have_sent = false;
+  report_stage_init();
+  _window_start_us = time_us_32();
+  _window_completed = 0;
+  _stats.polls_per_second = 1000 / usb_hid_poll_interval_ms();
+}
+
+void hid_reporter_set_min_interval(uint32_t min_interval_us)
+{
+  _min_interval_us = min_interval_us;
+}
+
+void hid_reporter_set_button_burst(bool enable)
+{
+  _button_burst = enable;
+}
+
+void hid_reporter_set_sample_time(uint32_t timestamp_us)
+{
+  // 0 marks "no new sample since the last report"
+  _sample_us = timestamp_us ? timestamp_us : 1;
+}
+
+// the completion callback runs shortly after the IN transfer, close enough to when the host got it
+static void record_sample_age(void)
+{
+  if (!_queued_has_sample)
+    return;
+
+  uint32_t age = time_us_32() - _queued_sample_us;
+  if (_stats.min_sample_age_us == 0 || age < _stats.min_sample_age_us)
+    _stats.min_sample_age_us = age;
+  if (age > _stats.max_sample_age_us)
+    _stats.max_sample_age_us = age;
+  if (_stats.avg_sample_age_us == 0)
+    _stats.avg_sample_age_us = age;
+  else
+    _stats.avg_sample_age_us += ((int32_t)age - (int32_t)_stats.avg_sample_age_us) / 16;
+  _stats.sample_age_us = age;
+  trace_event(TRACE_SAMPLE_AGE, age > 0xffff ? 0xffff : (uint16_t)age);
+}
+
+void hid_reporter_task(void)
+{
+  uint32_t now = time_us_32();
+  if (now - _window_start_us >= 1000000)
+  {
+    _stats.reports_per_second = _window_completed;
+    _window_completed = 0;
+    _window_start_us = now;
+  }
+
+  send_if_changed();
+}
+
+void hid_reporter_report_complete(void)
+{
+  _stats.reports_completed++;
+  _window_completed++;
+  trace_event(TRACE_REPORT_COMPLETE, (uint16_t)_stats.reports_completed);
+  record_sample_age();
+
+  if (send_if_changed())
+    _stats.chained++;
+}
+
+void hid_reporter_get_stats(hid_reporter_stats_t *stats)
+{
+  *stats = _stats;
+}
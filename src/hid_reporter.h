@@ -0,0 +1,67 @@
+#ifndef _tmext_hid_reporter_h
+#define _tmext_hid_reporter_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+// Reports are never queued closer together than this
+#ifndef HID_REPORTER_DEFAULT_MIN_INTERVAL_US
+#define HID_REPORTER_DEFAULT_MIN_INTERVAL_US 1000
+#endif
+
+// Send reports for latched button changes back to back, ignoring the minimum interval
+#ifndef HID_REPORTER_DEFAULT_BUTTON_BURST
+#define HID_REPORTER_DEFAULT_BUTTON_BURST true
+#endif
+
+  typedef struct
+  {
+    uint32_t reports_sent;       // reports queued since boot
+    uint32_t reports_completed;  // reports taken by the host since boot
+    uint32_t reports_per_second; // completed reports during the last full second
+    uint32_t polls_per_second;   // host poll slots per second of the IN endpoint
+    uint32_t chained;            // reports queued from the completion callback
+    uint32_t button_bursts;      // reports sent early for waiting button changes
+    uint32_t sample_age_us;      // age of the new sensor sample in the last report the host took
+    uint32_t min_sample_age_us;
+    uint32_t max_sample_age_us;
+    uint32_t avg_sample_age_us;  // moving average over the last 16 such reports or so
+  } hid_reporter_stats_t;
+
+  void hid_reporter_init(uint32_t min_interval_us);
+
+  void hid_reporter_set_min_interval(uint32_t min_interval_us);
+
+  /**
+   * @brief whether waiting button changes bypass the minimum interval
+   *
+   * A tap then takes two consecutive polls, one pressed and one released.
+   */
+  void hid_reporter_set_button_burst(bool enable);
+
+  /**
+   * @brief completion time of the sensor sample the joystick state was last updated from
+   */
+  void hid_reporter_set_sample_time(uint32_t timestamp_us);
+
+  /**
+   * @brief queue a report when the joystick state changed, call from the main loop
+   */
+  void hid_reporter_task(void);
+
+  /**
+   * @brief chain the next report, call from tud_hid_report_complete_cb
+   */
+  void hid_reporter_report_complete(void);
+
+  void hid_reporter_get_stats(hid_reporter_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_hid_reporter_h */
@@ -6,49 +6,14 @@ extern "C"
 {
 #endif
 
-#include <stdio.h>
-
-// values addresses
-#define BTN0_7 0
-#define BTN8_15 1
-#define BTN16_23 2
-#define BTN24_31 3
-#define BTN32_39 4
-#define BTN40_47 5
-#define BTN48_55 6
-#define BTN56_63 7
-#define BTN64_71 8
-#define BTN72_79 9
-#define BTN80_87 10
-#define BTN88_95 11
-#define BTN96_103 12
-#define BTN104_111 13
-#define BTN112_119 14
-#define BTN120_127 15
-
-#define X_AXIS_LSB 16
-#define X_AXIS_MSB 17
-#define Y_AXIS_LSB 18
-#define Y_AXIS_MSB 19
-
-#define HAT0_1 20 // Hats are 4 bit direction (0-9), 2 hats per byte
-#define HAT2_3 21
-
-#define Z_AXIS_LSB 22
-#define Z_AXIS_MSB 23
-#define Rx_AXIS_LSB 24
-#define Rx_AXIS_MSB 25
-#define Ry_AXIS_LSB 26
-#define Ry_AXIS_MSB 27
-#define Rz_AXIS_LSB 28
-#define Rz_AXIS_MSB 29
-
-#define THROTTLE_AXIS_LSB 30
-#define THROTTLE_AXIS_MSB 31
-// #define S0_AXIS_LSB 30
-// #define S0_AXIS_MSB 31
-#define S0_AXIS_LSB 32
-#define S0_AXIS_MSB 33
+// Joystick report layout, the single source for the HID report descriptor, the
+// tm_joystick_report struct and the packing in tm_joystick_fill_report.
+//
+// Report: | buttons, 1 bit each | hats, 4 bits each | axes, little endian |
+//
+// TM_JOYSTICK_EXTENDED selects the larger layout with 128 buttons, 4 hats and
+// Rx, Ry, Rz and throttle axes. It changes the descriptor, so the host has to
+// enumerate the device again.
 
 #define HAT_DIR_N 0
 #define HAT_DIR_NE 1
@@ -58,49 +23,120 @@ extern "C"
 #define HAT_DIR_SW 5
 #define HAT_DIR_W 6
 #define HAT_DIR_NW 7
-#define HAT_DIR_C 8
-
-    bool send_inputs(uint8_t *values);
-
-    bool test_send(uint16_t b0, uint16_t b1, uint16_t b2, uint16_t b3, uint16_t b4, uint16_t b5, uint16_t b6, uint16_t b7,
-                   uint16_t x, uint16_t y, uint16_t hats, uint16_t z, uint16_t Rx, uint16_t Ry, uint16_t Rz, uint16_t s0, uint16_t s1);
-
-    bool randomizeInputs();
-
-    void SetButton(int idx, bool val);
-    void SetX(uint16_t val);
-    void SetY(uint16_t val);
-    void SetZ(uint16_t val);
-    void SetRx(uint16_t val);
-    void SetRy(uint16_t val);
-    void SetRz(uint16_t val);
-    void SetS0(uint16_t val);
-    void SetThrottle(uint16_t val);
-    void SetS1(uint16_t val);
-
-    // 4 Hats available 0-3, direction is clockwise 0=N 1=NE 2=E 3=SE 4=S 5=SW 6=W 7=NW 8=CENTER
-    void SetHat(uint8_t hatIdx, uint8_t dir);
-
-    bool send_update();
-    /*
-     * To define the report descriptor. Warning: this method has to store the length of the report descriptor in reportLength.
-     *
-     * @returns pointer to the report descriptor
-     */
-    const uint8_t *report_desc();
-    /*
-     * Get configuration descriptor
-     *
-     * @returns pointer to the configuration descriptor
-     */
-    const uint8_t *configuration_desc(uint8_t index);
-
-    uint8_t inputArray[35];
-
-    uint8_t _configuration_descriptor[41];
+#define HAT_DIR_C 8 // centered, outside the logical range of the hat items
+
+// throttle on the simulation controls page
+#define TM_HID_USAGE_SIMULATION_THROTTLE 0xBB
+
+#if TM_JOYSTICK_EXTENDED
+
+#define TM_JOYSTICK_BUTTON_COUNT 128
+
+// HAT(index), an even number, two hats share a byte
+#define TM_JOYSTICK_HATS(HAT) \
+  HAT(0)                      \
+  HAT(1)                      \
+  HAT(2)                      \
+  HAT(3)
+
+// AXIS(name, usage page, usage, bits, input minimum, input maximum), bits is 8 or 16
+#define TM_JOYSTICK_AXES(AXIS)                                                                  \
+  AXIS(x, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X, 16, 0, 65535)                            \
+  AXIS(y, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y, 16, 0, 65535)                            \
+  AXIS(z, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Z, 16, 0, 4095)                             \
+  AXIS(s, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_SLIDER, 16, 0, 4095)                        \
+  AXIS(rx, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_RX, 16, 0, 4095)                           \
+  AXIS(ry, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_RY, 16, 0, 4095)                           \
+  AXIS(rz, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_RZ, 16, 0, 4095)                           \
+  AXIS(throttle, HID_USAGE_PAGE_SIMULATE, TM_HID_USAGE_SIMULATION_THROTTLE, 16, 0, 4095)
+
+#else
+
+#define TM_JOYSTICK_BUTTON_COUNT 32
+
+#define TM_JOYSTICK_HATS(HAT) \
+  HAT(0)                      \
+  HAT(1)
+
+#define TM_JOYSTICK_AXES(AXIS)                                           \
+  AXIS(x, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_X, 16, 0, 65535)     \
+  AXIS(y, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Y, 16, 0, 65535)     \
+  AXIS(z, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_Z, 16, 0, 4095)      \
+  AXIS(s, HID_USAGE_PAGE_DESKTOP, HID_USAGE_DESKTOP_SLIDER, 16, 0, 4095)
+
+#endif
+
+// Derived sizes
+
+#define TM_JOYSTICK_BUTTON_BYTES ((TM_JOYSTICK_BUTTON_COUNT + 7) / 8)
+
+#define _TM_JOYSTICK_COUNT_ONE(...) +1
+#define TM_JOYSTICK_HAT_COUNT (0 TM_JOYSTICK_HATS(_TM_JOYSTICK_COUNT_ONE))
+#define TM_JOYSTICK_HAT_BYTES (TM_JOYSTICK_HAT_COUNT / 2)
+#define TM_JOYSTICK_AXIS_COUNT (0 TM_JOYSTICK_AXES(_TM_JOYSTICK_COUNT_ONE))
+
+  // axis indices, TM_JOYSTICK_AXIS_x and so on
+  enum
+  {
+#define _TM_JOYSTICK_AXIS_INDEX(name, page, usage, bits, in_min, in_max) TM_JOYSTICK_AXIS_##name,
+    TM_JOYSTICK_AXES(_TM_JOYSTICK_AXIS_INDEX)
+#undef _TM_JOYSTICK_AXIS_INDEX
+  };
+
+// Report descriptor items, every item ends with a comma
+
+#define _TM_JOYSTICK_DESC_BUTTONS                   \
+  HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),            \
+      HID_USAGE_MIN(1),                             \
+      HID_USAGE_MAX(TM_JOYSTICK_BUTTON_COUNT),      \
+      HID_LOGICAL_MIN(0),                           \
+      HID_LOGICAL_MAX(1),                           \
+      HID_REPORT_COUNT(TM_JOYSTICK_BUTTON_COUNT),   \
+      HID_REPORT_SIZE(1),                           \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+
+#define _TM_JOYSTICK_DESC_HAT(index)                      \
+  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                 \
+      HID_USAGE(HID_USAGE_DESKTOP_HAT_SWITCH),            \
+      HID_LOGICAL_MIN(0),                                 \
+      HID_LOGICAL_MAX(7),                                 \
+      HID_PHYSICAL_MIN(0),                                \
+      HID_PHYSICAL_MAX_N(315, 2),                         \
+      HID_REPORT_COUNT(1),                                \
+      HID_REPORT_SIZE(4),                                 \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+
+#define _TM_JOYSTICK_DESC_AXIS(name, page, usage, bits, in_min, in_max) \
+  HID_USAGE_PAGE(page),                                                 \
+      HID_USAGE(usage),                                                 \
+      HID_LOGICAL_MIN(0x00),                                            \
+      HID_LOGICAL_MAX_N((1ul << (bits)) - 1, 3),                        \
+      HID_REPORT_COUNT(1),                                              \
+      HID_REPORT_SIZE(bits),                                            \
+      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+
+// complete joystick collection, the arguments are inserted first, e.g. a report ID
+#define TUD_HID_REPORT_DESC_JOYSTICK(...)                \
+  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                \
+      HID_USAGE(HID_USAGE_DESKTOP_JOYSTICK),             \
+      HID_COLLECTION(HID_COLLECTION_APPLICATION),        \
+      __VA_ARGS__                                        \
+      _TM_JOYSTICK_DESC_BUTTONS                          \
+      TM_JOYSTICK_HATS(_TM_JOYSTICK_DESC_HAT)            \
+      TM_JOYSTICK_AXES(_TM_JOYSTICK_DESC_AXIS)           \
+      HID_COLLECTION_END
+
+// Report struct fields
+
+#define _TM_JOYSTICK_REPORT_AXIS(name, page, usage, bits, in_min, in_max) uint8_t name[(bits) / 8];
+
+#define TM_JOYSTICK_REPORT_FIELDS              \
+  uint8_t buttons[TM_JOYSTICK_BUTTON_BYTES];   \
+  uint8_t hat[TM_JOYSTICK_HAT_BYTES];          \
+  TM_JOYSTICK_AXES(_TM_JOYSTICK_REPORT_AXIS)
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif /* _tmext_josystick_h */
\ No newline at end of file
+#endif /* _tmext_josystick_h */
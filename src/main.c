@@ -36,7 +36,20 @@
 #include "hardware/i2c.h"
 #include "pico/binary_info.h"
 #include "display/ssd1306.h"
+#include "ssd1306_images.h"
 #include "mlx90333/mlx90333.h"
+#include "hall_sensor.h"
+#include "hid_reporter.h"
+#include "settings.h"
+#include "display_task.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include "sof_sync.h"
+#include "benchmark.h"
+#include "usb_diagnostics.h"
+#include "report_cache.h"
+#include "config.h"
 
 //--------------------------------------------------------------------+
 // Display hardware setup
@@ -45,6 +58,7 @@
 #define DISPLAY_SCL_PIN 3
 #define DISPLAY_ADDRESS 0x3C
 #define DISPLAY_I2C_INSTANCE (i2c1)
+#define DISPLAY_SPLASH_MS 1500
 ssd1306_t disp;
 
 //--------------------------------------------------------------------+
@@ -73,10 +87,26 @@ enum
   BLINK_SUSPENDED = 2500,
 };
 
+// Task periods of the scheduler
+#define SENSOR_TASK_PERIOD_US 500
+#define REPORT_TASK_PERIOD_US 250
+#define DISPLAY_TASK_PERIOD_US 2000
+#define TEST_PATTERN_PERIOD_US 500000
+
 static uint32_t blink_interval_ms = BLINK_NOT_MOUNTED;
+static int led_task_id = -1;
+static int sensor_task_id = -1;
+static int report_task_id = -1;
 
+void set_blink_interval(uint32_t interval_ms);
 void led_blinking_task(void);
 void hid_task(void);
+void sensor_task(void);
+void report_task(void);
+bool hall_axes_task(void);
+void sample_ready(void);
+void display_step(void);
+void publish_display_view(void);
 void setup_display(void);
 void setup_hall_sensor(void);
 
@@ -85,21 +115,60 @@ int main(void)
 {
   stdio_init_all();
   board_init();
+  profile_init();
+  settings_init();
   setup_hall_sensor();
   tm_joystick_setup();
+#if TM_BENCHMARK
+  benchmark_run();
+#endif
   setup_display();
   tusb_init();
-  ssd1306_update_display(&disp, 10000u, 10000u, 100u);
+#if TM_TRACE || TM_SOF_SYNC
+  tud_sof_cb_enable(true);
+#endif
+  hid_reporter_init(settings_get()->min_report_interval_us);
+  display_task_init(&disp, DISPLAY_TASK_DEFAULT_FPS);
+  display_task_hold(DISPLAY_SPLASH_MS);
+  config_init();
+#if TM_DISPLAY_ON_CORE1
+  hall_sensor_set_core1_task(display_task_run);
+#endif
+  hall_sensor_set_sample_cb(sample_ready);
+  hall_sensor_start();
+
+  // tud_task runs between any two of these, see scheduler_run
+  sensor_task_id = scheduler_add("sensor", sensor_task, SENSOR_TASK_PERIOD_US, SCHEDULER_PRIORITY_HIGH);
+  report_task_id = scheduler_add("report", report_task, REPORT_TASK_PERIOD_US, SCHEDULER_PRIORITY_HIGH);
+  scheduler_add("display", display_step, DISPLAY_TASK_PERIOD_US, SCHEDULER_PRIORITY_NORMAL);
+  scheduler_add("pattern", hid_task, TEST_PATTERN_PERIOD_US, SCHEDULER_PRIORITY_LOW);
+  led_task_id = scheduler_add("led", led_blinking_task, blink_interval_ms * 1000, SCHEDULER_PRIORITY_LOW);
+
+  scheduler_run();
 
-  while (1)
-  {
-    tud_task(); // tinyusb device task
-    led_blinking_task();
+  return 0;
+}
 
-    hid_task();
-  }
+// Keep an acquisition in flight and hand new samples to the joystick state
+void sensor_task(void)
+{
+  hall_sensor_task();
+  // a new sample goes out with the next report right away
+  if (hall_axes_task())
+    scheduler_wake(report_task_id);
+}
 
-  return 0;
+// Configuration changes take effect between two reports, never within one
+void report_task(void)
+{
+  config_task();
+  hid_reporter_task();
+}
+
+// Runs in the context that published the sample, the timer IRQ or core 1
+void sample_ready(void)
+{
+  scheduler_wake(sensor_task_id);
 }
 
 //--------------------------------------------------------------------+
@@ -109,6 +178,28 @@ void setup_display(void)
 {
   ssd1306_init(&disp, 128, 64, DISPLAY_ADDRESS, DISPLAY_I2C_INSTANCE, DISPLAY_SDA_PIN, DISPLAY_SCL_PIN);
   bi_decl(bi_2pins_with_func(DISPLAY_SDA_PIN, DISPLAY_SCL_PIN, GPIO_FUNC_I2C))
+
+  // splash is converted from display/images/ at build time
+  const ssd1306_page_image_t *splash = &ssd1306_image_joystick;
+  ssd1306_blit_page_image(&disp, splash, (disp.width - splash->width) / 2, (disp.height - splash->height) / 2);
+  ssd1306_show(&disp);
+}
+
+// Publish the input state and, unless core 1 renders, draw the next frame
+void display_step(void)
+{
+  publish_display_view();
+#if !TM_DISPLAY_ON_CORE1
+  display_task_run();
+#endif
+}
+
+// Hand the current input state to the display renderer
+void publish_display_view(void)
+{
+  display_view_t view;
+  tm_joystick_getAxes(&view.x, &view.y, &view.z, &view.s);
+  display_task_publish(&view);
 }
 
 //--------------------------------------------------------------------+
@@ -117,12 +208,29 @@ void setup_display(void)
 void setup_hall_sensor(void)
 {
   mlx90333_setup(&hall_sensor, MLX_90333_SPI_PORT, MLX_90333_PIN_MISO, MLX_90333_PIN_MOSI, MLX_90333_PIN_SCK, MLX_90333_PIN_CS);
+  hall_sensor_init(&hall_sensor);
   // Make the SPI pins available to picotool
   bi_decl(bi_3pins_with_func(MLX_90333_PIN_MISO, MLX_90333_PIN_MOSI, MLX_90333_PIN_SCK, GPIO_FUNC_SPI))
       // Make the CS pin available to picotool
       bi_decl(bi_1pin_with_name(MLX_90333_PIN_CS, "SPI CS"))
 }
 
+// Take over the newest sample published by the acquisition side
+bool hall_axes_task(void)
+{
+  static uint32_t last_sequence = 0;
+  hall_sample_t sample;
+
+  if (!hall_sensor_latest(&sample) || sample.sequence == last_sequence)
+    return false;
+  last_sequence = sample.sequence;
+
+  tm_joystick_setXAxis(sample.x);
+  tm_joystick_setYAxis(sample.y);
+  hid_reporter_set_sample_time(sample.timestamp_us);
+  return true;
+}
+
 //--------------------------------------------------------------------+
 // Device callbacks
 //--------------------------------------------------------------------+
@@ -130,13 +238,13 @@ void setup_hall_sensor(void)
 // Invoked when device is mounted
 void tud_mount_cb(void)
 {
-  blink_interval_ms = BLINK_MOUNTED;
+  set_blink_interval(BLINK_MOUNTED);
 }
 
 // Invoked when device is unmounted
 void tud_umount_cb(void)
 {
-  blink_interval_ms = BLINK_NOT_MOUNTED;
+  set_blink_interval(BLINK_NOT_MOUNTED);
 }
 
 // Invoked when usb bus is suspended
@@ -145,20 +253,37 @@ void tud_umount_cb(void)
 void tud_suspend_cb(bool remote_wakeup_en)
 {
   (void)remote_wakeup_en;
-  blink_interval_ms = BLINK_SUSPENDED;
+  set_blink_interval(BLINK_SUSPENDED);
 }
 
 // Invoked when usb bus is resumed
 void tud_resume_cb(void)
 {
-  blink_interval_ms = BLINK_MOUNTED;
+  set_blink_interval(BLINK_MOUNTED);
 }
 
+#if TM_TRACE || TM_SOF_SYNC
+// Invoked from tud_task for every start of frame, the timestamp is when it was handled
+void tud_sof_cb(uint32_t frame_count)
+{
+  sof_sync_frame(frame_count, time_us_32());
+  trace_event(TRACE_SOF, (uint16_t)frame_count);
+}
+#endif
+
 //--------------------------------------------------------------------+
 // USB HID
 //--------------------------------------------------------------------+
 
-void send_hid_report(uint8_t testFunction)
+// With a sensor attached X and Y follow it, the test pattern leaves them alone
+static bool sensor_owns_xy(void)
+{
+  hall_sample_t sample;
+  return hall_sensor_latest(&sample);
+}
+
+// Step the input test pattern, reports are sent by hid_reporter_task() on change
+void step_test_pattern(uint8_t testFunction)
 {
   static uint32_t lastTestFunction = 0;
   static uint8_t currentButton = 31;
@@ -169,23 +294,6 @@ void send_hid_report(uint8_t testFunction)
   static int32_t zValue = 0;
   static int32_t sValue = 0;
 
-  // skip if hid is not ready yet
-  if (!tud_hid_ready())
-  {
-    blink_interval_ms = 0;
-    return;
-  }
-  blink_interval_ms = BLINK_MOUNTED;
-
-  tm_joystick_report report = {
-      .buttons = {0, 0, 0, 0},
-      .hat = {0x11},
-      .x = {125, 125},
-      .y = {0, 0},
-      .z = {0, 0},
-      .s = {0, 0}};
-  ssd1306_debug_values(&disp, testFunction, hat1Value);
-
   switch (testFunction)
   {
   case 0: // buttons
@@ -235,6 +343,8 @@ void send_hid_report(uint8_t testFunction)
       tm_joystick_setHatSwitch(2, -1);
       lastTestFunction = 3;
     }
+    if (sensor_owns_xy())
+      break;
     tm_joystick_setXAxis(xValue);
     xValue += 0x0300;
     if (xValue > 0xffff)
@@ -245,9 +355,12 @@ void send_hid_report(uint8_t testFunction)
   case 4: // y
     if (lastTestFunction == 3)
     {
-      tm_joystick_setXAxis(0);
+      if (!sensor_owns_xy())
+        tm_joystick_setXAxis(0);
       lastTestFunction = 4;
     }
+    if (sensor_owns_xy())
+      break;
     tm_joystick_setYAxis(yValue);
     yValue += 0x0300;
     if (yValue > 0xffff)
@@ -258,7 +371,8 @@ void send_hid_report(uint8_t testFunction)
   case 5: // z
     if (lastTestFunction == 4)
     {
-      tm_joystick_setYAxis(0);
+      if (!sensor_owns_xy())
+        tm_joystick_setYAxis(0);
       lastTestFunction = 5;
     }
     tm_joystick_setZAxis(zValue);
@@ -284,23 +398,14 @@ void send_hid_report(uint8_t testFunction)
   default:
     break;
   }
-  tm_joystick_fill_report(&report);
-  tud_hid_report(0, &report, sizeof(report));
 }
 
-// Every 10ms, we will sent 1 report for each HID profile (keyboard, mouse etc ..)
+// Scheduled every TEST_PATTERN_PERIOD_US, the test pattern advances one step
 // tud_hid_report_complete_cb() is used to send the next report after previous one is complete
 void hid_task(void)
 {
-  // Poll every 500ms
-  static const uint32_t interval_ms = 500;
-  static uint32_t start_ms = 0;
   static uint8_t testFunction = 0;
 
-  if (board_millis() - start_ms < interval_ms)
-    return; // not enough time
-  start_ms += interval_ms;
-
   uint32_t const btn = board_button_read();
 
   // Remote wakeup
@@ -320,19 +425,20 @@ void hid_task(void)
         testFunction = 0;
       }
     }
-    // Send the 1st of report chain, the rest will be sent by tud_hid_report_complete_cb()
-    send_hid_report(testFunction);
+    step_test_pattern(testFunction);
   }
 }
 
 // Invoked when sent REPORT successfully to host
 // Application can use this to send the next report
 // Note: For composite reports, report[0] is report ID
-void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint8_t len)
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
 {
-  (void)instance;
   (void)len;
   (void)report;
+
+  if (instance == HID_INSTANCE_JOYSTICK)
+    hid_reporter_report_complete();
 }
 
 // Invoked when received GET_REPORT control request
@@ -340,43 +446,34 @@ void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint8_t
 // Return zero will cause the stack to STALL request
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
 {
-  // TODO not Implemented
-  (void)instance;
-  (void)report_id;
-  (void)report_type;
-  (void)buffer;
-  (void)reqlen;
-
-  return 0;
+  // the last input report and stored feature reports, diagnostics are measured on request
+  return report_cache_get_report(instance, report_id, report_type, buffer, reqlen);
 }
 
 // Invoked when received SET_REPORT control request or
 // received data on OUT endpoint ( Report ID = 0, Type = 0 )
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
 {
-  (void)instance;
-  (void)report_id;
-  (void)report_type;
-  (void)buffer;
-  (void)bufsize;
+  if (instance == HID_INSTANCE_DIAG && !config_set_report(report_id, report_type, buffer, bufsize))
+    usb_diag_set_report(report_id, report_type, buffer, bufsize);
 }
 
 //--------------------------------------------------------------------+
 // BLINKING TASK
 //--------------------------------------------------------------------+
-void led_blinking_task(void)
+// The scheduler runs the LED task once per blink interval, 0 suspends it
+void set_blink_interval(uint32_t interval_ms)
 {
-  static uint32_t start_ms = 0;
-  static bool led_state = false;
-
-  // blink is disabled
-  if (!blink_interval_ms)
+  if (interval_ms == blink_interval_ms)
     return;
 
-  // Blink every interval ms
-  if (board_millis() - start_ms < blink_interval_ms)
-    return; // not enough time
-  start_ms += blink_interval_ms;
+  blink_interval_ms = interval_ms;
+  scheduler_set_period(led_task_id, interval_ms * 1000);
+}
+
+void led_blinking_task(void)
+{
+  static bool led_state = false;
 
   board_led_write(led_state);
   led_state = !led_state; // toggle
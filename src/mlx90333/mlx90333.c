@@ -1,7 +1,28 @@
 #include "mlx90333.h"
+#include "hardware/dma.h"
+#if MLX90333_USE_PIO
+#include "mlx90333_spi.pio.h"
+
+#ifndef MLX90333_PIO
+#define MLX90333_PIO pio0
+#endif
+#endif
+
+// frame timing, see mlx90333_get_axis_data
+#define MLX90333_BAUDRATE (240 * 1000)
+#define MLX90333_CS_SETTLE_US 3000
+#define MLX90333_BYTE_US (8 * 1000 * 1000 / MLX90333_BAUDRATE + 1)
+#define MLX90333_FIRST_GAP_US 50
+#define MLX90333_GAP_US 20
+#define MLX90333_CS_HOLD_US 3
+#define MLX90333_DMA_RETRY_US 2
 
 uint8_t read_buffer[8];
 
+#if !MLX90333_USE_PIO
+static const uint8_t dummy_tx = 0;
+#endif
+
 static inline void cs_select(const mlx_90333_t *sensor)
 {
     asm volatile("nop \n nop \n nop");
@@ -26,7 +47,30 @@ void mlx90333_setup(mlx_90333_t *sensor, spi_inst_t *spi, uint miso, uint mosi,
     sensor->PIN_SCK = sck;
     sensor->PIN_CS = cs;
 
-    spi_init(sensor->SPI_PORT, 240 * 1000); // 320.000 is about max
+#if MLX90333_USE_PIO
+    // MOSI is only ever low
+    gpio_init(sensor->PIN_MOSI);
+    gpio_set_dir(sensor->PIN_MOSI, GPIO_OUT);
+    gpio_put(sensor->PIN_MOSI, 0);
+
+    sensor->pio = MLX90333_PIO;
+    sensor->sm = pio_claim_unused_sm(sensor->pio, true);
+    sensor->offset = pio_add_program(sensor->pio, &mlx90333_spi_program);
+    mlx90333_spi_program_init(sensor->pio, sensor->sm, sensor->offset, sensor->PIN_MISO, sensor->PIN_SCK, sensor->PIN_CS, MLX90333_BAUDRATE);
+    // PIO uses the longer first gap after every byte
+    sensor->trigger = mlx90333_spi_trigger(MLX90333_BAUDRATE, MLX90333_CS_SETTLE_US, MLX90333_FIRST_GAP_US);
+    sensor->frame_us = mlx90333_spi_frame_us(MLX90333_BAUDRATE, sensor->trigger);
+
+    // whole frame in one transfer, the state machine paces the bytes
+    sensor->dma_rx = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(sensor->dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(sensor->pio, sensor->sm, false));
+    dma_channel_configure(sensor->dma_rx, &c, sensor->frame, &sensor->pio->rxf[sensor->sm], MLX90333_FRAME_SIZE, false);
+#else
+    spi_init(sensor->SPI_PORT, MLX90333_BAUDRATE); // 320.000 is about max
     spi_set_format(sensor->SPI_PORT, 8, SPI_CPOL_0, SPI_CPHA_1, SPI_MSB_FIRST);
     gpio_set_function(sensor->PIN_MISO, GPIO_FUNC_SPI);
     gpio_set_function(sensor->PIN_SCK, GPIO_FUNC_SPI);
@@ -36,6 +80,30 @@ void mlx90333_setup(mlx_90333_t *sensor, spi_inst_t *spi, uint miso, uint mosi,
     gpio_init(sensor->PIN_CS);
     gpio_set_dir(sensor->PIN_CS, GPIO_OUT);
     gpio_put(sensor->PIN_CS, 1);
+
+    // one byte per transfer, the alarm callback retriggers both channels for every byte
+    sensor->dma_tx = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(sensor->dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(sensor->SPI_PORT, true));
+    dma_channel_configure(sensor->dma_tx, &c, &spi_get_hw(sensor->SPI_PORT)->dr, &dummy_tx, 1, false);
+
+    sensor->dma_rx = dma_claim_unused_channel(true);
+    c = dma_channel_get_default_config(sensor->dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(sensor->SPI_PORT, false));
+    dma_channel_configure(sensor->dma_rx, &c, sensor->frame, &spi_get_hw(sensor->SPI_PORT)->dr, 1, false);
+#endif
+
+    sensor->state = MLX90333_IDLE;
+    sensor->step = 0;
+    sensor->data = NULL;
+    sensor->callback = NULL;
+    sensor->user_data = NULL;
 }
 
 void fill_data(const uint8_t buffer[8], mlx_90333_axis_data_t *data)
@@ -63,6 +131,13 @@ void fill_data(const uint8_t buffer[8], mlx_90333_axis_data_t *data)
 
 void mlx90333_get_axis_data(const mlx_90333_t *sensor, mlx_90333_axis_data_t *data)
 {
+#if MLX90333_USE_PIO
+    pio_sm_put_blocking(sensor->pio, sensor->sm, sensor->trigger);
+    for (int i = 0; i < 8; i++)
+    {
+        read_buffer[i] = (uint8_t)pio_sm_get_blocking(sensor->pio, sensor->sm);
+    }
+#else
     const uint8_t sendBuff = 0;
     uint8_t readBuff = 0;
     cs_select(sensor);
@@ -76,10 +151,122 @@ void mlx90333_get_axis_data(const mlx_90333_t *sensor, mlx_90333_axis_data_t *da
     {
         sleep_us(20);
         spi_write_read_blocking(sensor->SPI_PORT, &sendBuff, &readBuff, 1);
-        read_buffer[0] = readBuff;
+        read_buffer[i] = readBuff;
     }
     sleep_us(3);
     cs_deselect(sensor);
+#endif
 
     fill_data(read_buffer, data);
 }
+
+#if MLX90333_USE_PIO
+// stop a frame in flight, the state machine waits for the next trigger with CS released
+static void abort_frame(mlx_90333_t *sensor)
+{
+    dma_channel_abort(sensor->dma_rx);
+    pio_sm_set_enabled(sensor->pio, sensor->sm, false);
+    pio_sm_clear_fifos(sensor->pio, sensor->sm);
+    pio_sm_restart(sensor->pio, sensor->sm);
+    // side-set is 0 in both, SCK stays low
+    pio_sm_exec(sensor->pio, sensor->sm, pio_encode_set(pio_pins, 1));
+    pio_sm_exec(sensor->pio, sensor->sm, pio_encode_jmp(sensor->offset));
+    pio_sm_set_enabled(sensor->pio, sensor->sm, true);
+}
+
+static int64_t read_step_cb(alarm_id_t id, void *user_data)
+{
+    (void)id;
+    mlx_90333_t *sensor = (mlx_90333_t *)user_data;
+
+    if (dma_channel_is_busy(sensor->dma_rx))
+        return MLX90333_DMA_RETRY_US;
+
+    fill_data(sensor->frame, sensor->data);
+    sensor->state = MLX90333_DONE;
+    if (sensor->callback)
+        sensor->callback(sensor->data, sensor->user_data);
+
+    return 0;
+}
+#else
+static inline void start_byte(mlx_90333_t *sensor, uint8_t index)
+{
+    dma_channel_set_write_addr(sensor->dma_rx, &sensor->frame[index], false);
+    dma_channel_set_trans_count(sensor->dma_rx, 1, false);
+    dma_channel_set_trans_count(sensor->dma_tx, 1, false);
+    dma_start_channel_mask((1u << sensor->dma_rx) | (1u << sensor->dma_tx));
+}
+
+static int64_t read_step_cb(alarm_id_t id, void *user_data)
+{
+    (void)id;
+    mlx_90333_t *sensor = (mlx_90333_t *)user_data;
+
+    // previous byte still shifting, check again shortly
+    if (sensor->step > 0 && dma_channel_is_busy(sensor->dma_rx))
+        return MLX90333_DMA_RETRY_US;
+
+    if (sensor->step < MLX90333_FRAME_SIZE)
+    {
+        start_byte(sensor, sensor->step);
+        sensor->step++;
+        if (sensor->step == MLX90333_FRAME_SIZE)
+            return MLX90333_BYTE_US + MLX90333_CS_HOLD_US;
+        return MLX90333_BYTE_US + (sensor->step == 1 ? MLX90333_FIRST_GAP_US : MLX90333_GAP_US);
+    }
+
+    cs_deselect(sensor);
+    fill_data(sensor->frame, sensor->data);
+    sensor->state = MLX90333_DONE;
+    if (sensor->callback)
+        sensor->callback(sensor->data, sensor->user_data);
+
+    return 0;
+}
+#endif
+
+bool mlx90333_start_read(mlx_90333_t *sensor, mlx_90333_axis_data_t *data, mlx90333_read_cb_t callback, void *user_data)
+{
+    if (sensor->state == MLX90333_BUSY)
+        return false;
+
+    sensor->data = data;
+    sensor->callback = callback;
+    sensor->user_data = user_data;
+    sensor->step = 0;
+    sensor->state = MLX90333_BUSY;
+
+#if MLX90333_USE_PIO
+    dma_channel_set_write_addr(sensor->dma_rx, sensor->frame, false);
+    dma_channel_set_trans_count(sensor->dma_rx, MLX90333_FRAME_SIZE, true);
+    pio_sm_put(sensor->pio, sensor->sm, sensor->trigger);
+    if (add_alarm_in_us(sensor->frame_us, read_step_cb, sensor, true) < 0)
+    {
+        // no free alarm slot, nothing would collect the frame
+        abort_frame(sensor);
+        sensor->state = MLX90333_IDLE;
+        return false;
+    }
+#else
+    cs_select(sensor);
+    if (add_alarm_in_us(MLX90333_CS_SETTLE_US, read_step_cb, sensor, true) < 0)
+    {
+        // no free alarm slot
+        cs_deselect(sensor);
+        sensor->state = MLX90333_IDLE;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+mlx_90333_read_state_t mlx90333_poll(mlx_90333_t *sensor)
+{
+    mlx_90333_read_state_t state = sensor->state;
+    if (state == MLX90333_DONE)
+        sensor->state = MLX90333_IDLE;
+
+    return state;
+}
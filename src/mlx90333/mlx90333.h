@@ -10,14 +10,11 @@ extern "C" {
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/spi.h"
+#if MLX90333_USE_PIO
+#include "hardware/pio.h"
+#endif
 
-typedef struct {
-    uint PIN_MISO;
-    uint PIN_MOSI;
-    uint PIN_SCK;
-    uint PIN_CS;
-    spi_inst_t * SPI_PORT;
-} mlx_90333_t;
+#define MLX90333_FRAME_SIZE 8
 
 typedef struct 
 {
@@ -30,9 +27,49 @@ typedef struct
     bool valid;
 } mlx_90333_axis_data_t;
 
+/**
+*	@brief invoked when an asynchronous read finished, runs in timer IRQ context
+*/
+typedef void (*mlx90333_read_cb_t)(const mlx_90333_axis_data_t *data, void *user_data);
+
+typedef enum {
+    MLX90333_IDLE = 0,
+    MLX90333_BUSY,
+    MLX90333_DONE
+} mlx_90333_read_state_t;
+
+typedef struct {
+    uint PIN_MISO;
+    uint PIN_MOSI;
+    uint PIN_SCK;
+    uint PIN_CS;
+    spi_inst_t * SPI_PORT;
+
+#if MLX90333_USE_PIO
+    PIO pio;
+    uint sm;
+    uint offset;
+    uint32_t trigger;
+    uint32_t frame_us;
+#endif
+
+    // asynchronous read state
+    uint dma_tx;
+    uint dma_rx;
+    volatile mlx_90333_read_state_t state;
+    uint8_t step;
+    uint8_t frame[MLX90333_FRAME_SIZE];
+    mlx_90333_axis_data_t *data;
+    mlx90333_read_cb_t callback;
+    void *user_data;
+} mlx_90333_t;
+
 /**
 *	@brief initialize mlx 90333 hal sensor and spi port
 *
+*	With MLX90333_USE_PIO the frame is clocked by a PIO state machine on the same
+*	pins and spi is unused.
+*
 *	@param[in] sensor : pointer to instance of mlx_90333_t
 *	@param[in] spi : pointer to SPI instance
 *	@param[in] miso : miso pin number
@@ -55,6 +92,34 @@ void mlx90333_setup(mlx_90333_t *sensor, spi_inst_t *spi, uint miso, uint mosi,
 */
 void mlx90333_get_axis_data(const mlx_90333_t* sensor, mlx_90333_axis_data_t* data);
 
+/**
+*	@brief start a non-blocking read of one frame from mlx 90333 hal sensor
+*
+*	Bytes are paced by timer alarms and moved by DMA, the CPU is free until the
+*	frame is complete. data must stay valid until the read finished.
+*
+*	@param[in] sensor : pointer to instance of mlx_90333_t
+*	@param[in] data : pointer to mlx_90333_axis_data_t instance filled on completion
+*	@param[in] callback : invoked from timer IRQ on completion, may be NULL
+*	@param[in] user_data : passed to callback
+*
+* 	@return bool.
+*	@retval true if the read was started
+*	@retval false if a read is already in progress
+*/
+bool mlx90333_start_read(mlx_90333_t *sensor, mlx_90333_axis_data_t *data, mlx90333_read_cb_t callback, void *user_data);
+
+/**
+*	@brief poll state of asynchronous read
+*
+*	Returns MLX90333_DONE once per finished frame, afterwards the sensor is idle again.
+*
+*	@param[in] sensor : pointer to instance of mlx_90333_t
+*
+* 	@return mlx_90333_read_state_t.
+*/
+mlx_90333_read_state_t mlx90333_poll(mlx_90333_t *sensor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,114 @@
+#include <string.h>
+
+#include "hardware/clocks.h"
+#include "profile.h"
+#include "seqlock.h"
+
+static const char *const _stage_names[PROFILE_STAGE_COUNT] = {
+    [PROFILE_SENSOR_READ] = "sens",
+    [PROFILE_FILL_REPORT] = "fill",
+    [PROFILE_DISPLAY_RENDER] = "draw",
+    [PROFILE_DISPLAY_SHOW] = "show",
+    [PROFILE_TUD_TASK] = "usb",
+};
+
+static uint32_t _cycles_per_us = 125;
+
+#if TM_PROFILE
+
+#define SYSTICK_MASK 0x00ffffffu
+
+// each stage is written by one core only, readers on either core use the seqlock
+static profile_stats_t _stats[PROFILE_STAGE_COUNT];
+static seqlock_t _locks[PROFILE_STAGE_COUNT];
+
+// a reset is carried out by the writer of each stage, so there stays a single writer
+static volatile uint32_t _reset_generation;
+static uint32_t _stage_generation[PROFILE_STAGE_COUNT];
+
+void profile_init(void)
+{
+  _cycles_per_us = clock_get_hz(clk_sys) / 1000000;
+
+  // count processor clocks down from 2^24 - 1, no interrupt
+  systick_hw->csr = 0;
+  systick_hw->rvr = SYSTICK_MASK;
+  systick_hw->cvr = 0;
+  systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void profile_record(profile_stage_t stage, uint32_t start)
+{
+  // SysTick counts down
+  uint32_t cycles = (start - profile_now()) & SYSTICK_MASK;
+  profile_stats_t *s = &_stats[stage];
+  uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+
+  seqlock_write_begin(&_locks[stage]);
+  if (_stage_generation[stage] != _reset_generation)
+  {
+    _stage_generation[stage] = _reset_generation;
+    memset(s, 0, sizeof(*s));
+  }
+  if (s->count == 0 || cycles < s->min_cycles)
+    s->min_cycles = cycles;
+  if (cycles > s->max_cycles)
+    s->max_cycles = cycles;
+  s->total_cycles += cycles;
+  s->histogram[bucket]++;
+  s->count++;
+  seqlock_write_end(&_locks[stage]);
+}
+
+bool profile_enabled(void)
+{
+  return true;
+}
+
+void profile_get(profile_stage_t stage, profile_stats_t *stats)
+{
+  uint32_t sequence;
+  do
+  {
+    sequence = seqlock_read_begin(&_locks[stage]);
+    *stats = _stats[stage];
+  } while (seqlock_read_retry(&_locks[stage], sequence));
+
+  // not recorded since the last reset
+  if (_stage_generation[stage] != _reset_generation)
+    memset(stats, 0, sizeof(*stats));
+}
+
+void profile_reset(void)
+{
+  _reset_generation++;
+}
+
+#else
+
+bool profile_enabled(void)
+{
+  return false;
+}
+
+void profile_get(profile_stage_t stage, profile_stats_t *stats)
+{
+  (void)stage;
+  memset(stats, 0, sizeof(*stats));
+}
+
+void profile_reset(void)
+{
+}
+
+#endif
+
+const char *profile_stage_name(profile_stage_t stage)
+{
+  return stage < PROFILE_STAGE_COUNT ? _stage_names[stage] : "";
+}
+
+uint32_t profile_cycles_to_us(uint32_t cycles)
+{
+  return cycles / _cycles_per_us;
+}
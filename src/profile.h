@@ -0,0 +1,90 @@
+#ifndef _tmext_profile_h
+#define _tmext_profile_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#if TM_PROFILE
+#include "hardware/structs/systick.h"
+#endif
+
+// Stage timing in CPU cycles from the SysTick of the measuring core.
+// With TM_PROFILE unset the macros compile to nothing and every stage reads as empty.
+
+  typedef enum
+  {
+    PROFILE_SENSOR_READ,    // one MLX90333 frame, request to data
+    PROFILE_FILL_REPORT,    // tm_joystick_fill_report
+    PROFILE_DISPLAY_RENDER, // drawing one frame into the buffer
+    PROFILE_DISPLAY_SHOW,   // ssd1306_show_async, building and starting the transfer
+    PROFILE_TUD_TASK,       // one tud_task call
+    PROFILE_STAGE_COUNT
+  } profile_stage_t;
+
+// bucket n counts durations of 2^n to 2^(n+1) - 1 cycles, the SysTick is 24 bits wide
+#define PROFILE_HISTOGRAM_BUCKETS 24
+
+  typedef struct
+  {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+  } profile_stats_t;
+
+#if TM_PROFILE
+
+  // start the SysTick of the calling core, every core that records a stage calls this once
+  void profile_init(void);
+
+  static inline uint32_t profile_now(void)
+  {
+    return systick_hw->cvr;
+  }
+
+  void profile_record(profile_stage_t stage, uint32_t start);
+
+#define PROFILE_BEGIN(stage) const uint32_t _profile_start_##stage = profile_now()
+#define PROFILE_END(stage) profile_record(stage, _profile_start_##stage)
+// for stages that begin and end in different functions, e.g. a callback
+#define PROFILE_STAMP(var) ((var) = profile_now())
+#define PROFILE_RECORD(stage, start) profile_record(stage, start)
+
+#else
+
+  static inline void profile_init(void) {}
+
+#define PROFILE_BEGIN(stage) \
+  do                         \
+  {                          \
+  } while (0)
+#define PROFILE_END(stage) \
+  do                       \
+  {                        \
+  } while (0)
+#define PROFILE_STAMP(var) ((void)(var))
+#define PROFILE_RECORD(stage, start) ((void)(start))
+
+#endif
+
+  bool profile_enabled(void);
+
+  const char *profile_stage_name(profile_stage_t stage);
+
+  // consistent copy of one stage, safe against the recording core
+  void profile_get(profile_stage_t stage, profile_stats_t *stats);
+
+  void profile_reset(void);
+
+  // converts cycles to microseconds, rounded down
+  uint32_t profile_cycles_to_us(uint32_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_profile_h */
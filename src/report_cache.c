@@ -0,0 +1,101 @@
+#include <string.h>
+
+#include "report_cache.h"
+#include "report_stage.h"
+#include "usb_descriptors.h"
+#include "usb_diagnostics.h"
+
+typedef struct
+{
+  uint8_t instance;
+  uint8_t report_id; // 0 marks a free slot, feature reports always carry an ID
+  uint16_t len;
+  uint8_t data[REPORT_CACHE_FEATURE_SIZE];
+} feature_slot_t;
+
+static feature_slot_t _features[REPORT_CACHE_FEATURE_SLOTS];
+static report_cache_stats_t _stats;
+
+static feature_slot_t *find_feature(uint8_t instance, uint8_t report_id)
+{
+  for (int i = 0; i < REPORT_CACHE_FEATURE_SLOTS; ++i)
+  {
+    if (_features[i].report_id == report_id && _features[i].instance == instance)
+      return &_features[i];
+  }
+  return NULL;
+}
+
+bool report_cache_set_feature(uint8_t instance, uint8_t report_id, const void *data, uint16_t len)
+{
+  if (report_id == 0 || len > REPORT_CACHE_FEATURE_SIZE)
+    return false;
+
+  feature_slot_t *slot = find_feature(instance, report_id);
+  if (!slot)
+    slot = find_feature(0, 0);
+  if (!slot)
+    return false;
+
+  slot->instance = instance;
+  slot->report_id = report_id;
+  slot->len = len;
+  memcpy(slot->data, data, len);
+  return true;
+}
+
+static uint16_t input_report(uint8_t *buffer, uint16_t reqlen)
+{
+  if (reqlen < sizeof(tm_joystick_report))
+    return 0;
+
+  const tm_joystick_report *last = report_stage_last_sent();
+  if (last)
+  {
+    memcpy(buffer, last, sizeof(tm_joystick_report));
+    _stats.input_hits++;
+  }
+  else
+  {
+    // before the first report, the host still gets the current state instead of a STALL
+    tm_joystick_fill_report((tm_joystick_report *)buffer);
+    _stats.input_built++;
+  }
+  return sizeof(tm_joystick_report);
+}
+
+uint16_t report_cache_get_report(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
+                                 uint8_t *buffer, uint16_t reqlen)
+{
+  uint16_t len = 0;
+
+  if (instance == HID_INSTANCE_JOYSTICK && report_type == HID_REPORT_TYPE_INPUT && report_id == 0)
+  {
+    len = input_report(buffer, reqlen);
+  }
+  else if (report_type == HID_REPORT_TYPE_FEATURE)
+  {
+    const feature_slot_t *slot = find_feature(instance, report_id);
+    if (slot && reqlen >= slot->len)
+    {
+      memcpy(buffer, slot->data, slot->len);
+      len = slot->len;
+      _stats.feature_hits++;
+    }
+    else if (!slot && instance == HID_INSTANCE_DIAG)
+    {
+      len = usb_diag_get_report(report_id, report_type, buffer, reqlen);
+      if (len)
+        _stats.feature_live++;
+    }
+  }
+
+  if (!len)
+    _stats.stalled++;
+  return len;
+}
+
+void report_cache_get_stats(report_cache_stats_t *stats)
+{
+  *stats = _stats;
+}
@@ -0,0 +1,50 @@
+#ifndef _tmext_report_cache_h
+#define _tmext_report_cache_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+// Answers GET_REPORT without building anything. Input reports come from the buffer
+// last handed to the joystick endpoint, feature reports from copies stored whenever
+// their content changes. Measurements on the diagnostics interface are not cached,
+// they are taken when the host asks.
+
+#ifndef REPORT_CACHE_FEATURE_SLOTS
+#define REPORT_CACHE_FEATURE_SLOTS 4
+#endif
+#define REPORT_CACHE_FEATURE_SIZE 63 // payload without the report ID, DIAG_PAYLOAD_SIZE
+
+  typedef struct
+  {
+    uint32_t input_hits;   // input reports answered with the last sent one
+    uint32_t input_built;  // input reports asked for before the first one was sent, built on the spot
+    uint32_t feature_hits; // feature reports answered from the cache
+    uint32_t feature_live; // diagnostics feature reports, measured on request
+    uint32_t stalled;      // unknown reports, other report types or too short requests
+  } report_cache_stats_t;
+
+  /**
+   * @brief store the content of a feature report, replaces an earlier copy
+   *
+   * Call from the core that runs tud_task.
+   *
+   * @return false if all REPORT_CACHE_FEATURE_SLOTS hold other reports or len is too large
+   */
+  bool report_cache_set_feature(uint8_t instance, uint8_t report_id, const void *data, uint16_t len);
+
+  // called from tud_hid_get_report_cb, 0 makes the stack STALL the request
+  uint16_t report_cache_get_report(uint8_t instance, uint8_t report_id, hid_report_type_t report_type,
+                                   uint8_t *buffer, uint16_t reqlen);
+
+  void report_cache_get_stats(report_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_report_cache_h */
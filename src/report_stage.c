@@ -0,0 +1,127 @@
+#include "hardware/sync.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "report_stage.h"
+
+#define NO_BUFFER 0xff
+
+// every buffer starts word aligned, the way TinyUSB keeps its own endpoint buffers
+typedef struct TU_ATTR_ALIGNED(4)
+{
+  tm_joystick_report report;
+} report_buffer_t;
+
+CFG_TUSB_MEM_SECTION static report_buffer_t _buffers[2];
+
+static spin_lock_t *_lock;
+// buffer indices, only changed with _lock held
+static uint8_t _sent = NO_BUFFER;      // last handed to the endpoint, never written by the producer
+static uint8_t _published = NO_BUFFER; // complete and waiting to be sent
+static uint8_t _writing = NO_BUFFER;   // held by the producer
+static bool _sent_valid;               // the endpoint accepted the buffer in _sent
+
+static report_stage_stats_t _stats;
+
+void report_stage_init(void)
+{
+  if (!_lock)
+    _lock = spin_lock_instance(spin_lock_claim_unused(true));
+
+  _sent = NO_BUFFER;
+  _published = NO_BUFFER;
+  _writing = NO_BUFFER;
+  _sent_valid = false;
+  _stats = (report_stage_stats_t){0};
+}
+
+tm_joystick_report *report_stage_begin(void)
+{
+  uint32_t status = spin_lock_blocking(_lock);
+
+  // the buffer that is not the last sent one, it may hold an unsent report
+  const uint8_t index = _sent == 0 ? 1 : 0;
+  if (_published == index)
+  {
+    _published = NO_BUFFER;
+    _stats.superseded++;
+  }
+  _writing = index;
+
+  spin_unlock(_lock, status);
+  return &_buffers[index].report;
+}
+
+void report_stage_publish(void)
+{
+  uint32_t status = spin_lock_blocking(_lock);
+  if (_writing != NO_BUFFER)
+  {
+    _published = _writing;
+    _writing = NO_BUFFER;
+    _stats.published++;
+  }
+  spin_unlock(_lock, status);
+}
+
+void report_stage_discard(void)
+{
+  uint32_t status = spin_lock_blocking(_lock);
+  _writing = NO_BUFFER;
+  spin_unlock(_lock, status);
+}
+
+const tm_joystick_report *report_stage_last_sent(void)
+{
+  // _sent only changes in report_stage_send, on the core that calls this
+  return _sent_valid ? &_buffers[_sent].report : NULL;
+}
+
+bool report_stage_pending(void)
+{
+  return _published != NO_BUFFER;
+}
+
+bool report_stage_send(void)
+{
+  if (_published == NO_BUFFER || !tud_ready())
+    return false;
+
+  if (!usbd_edpt_claim(BOARD_DEVICE_RHPORT_NUM, EPNUM_HID))
+  {
+    _stats.busy++;
+    return false;
+  }
+
+  uint32_t status = spin_lock_blocking(_lock);
+  const uint8_t index = _published;
+  if (index != NO_BUFFER)
+  {
+    _published = NO_BUFFER;
+    _sent = index;
+  }
+  spin_unlock(_lock, status);
+
+  if (index == NO_BUFFER)
+  {
+    // taken back by a producer on the other core
+    usbd_edpt_release(BOARD_DEVICE_RHPORT_NUM, EPNUM_HID);
+    return false;
+  }
+
+  // the endpoint reads straight from the buffer, it stays untouched until the next send
+  _sent_valid = usbd_edpt_xfer(BOARD_DEVICE_RHPORT_NUM, EPNUM_HID, (uint8_t *)&_buffers[index].report,
+                               sizeof(tm_joystick_report));
+  if (!_sent_valid)
+  {
+    usbd_edpt_release(BOARD_DEVICE_RHPORT_NUM, EPNUM_HID);
+    return false;
+  }
+
+  _stats.sent++;
+  return true;
+}
+
+void report_stage_get_stats(report_stage_stats_t *stats)
+{
+  *stats = _stats;
+}
@@ -0,0 +1,67 @@
+#ifndef _tmext_report_stage_h
+#define _tmext_report_stage_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "usb_descriptors.h"
+
+  // Two joystick report buffers between the producer and the IN endpoint.
+  //
+  // One buffer holds the report last handed to the endpoint, the producer builds
+  // the next one in the other and publishes it with an index swap. The USB side
+  // transfers the published buffer as it is, a report is never copied and never
+  // read while it is being written. The swap is guarded by a hardware spin lock,
+  // so producer and USB side may run on different cores.
+
+  typedef struct
+  {
+    uint32_t published;  // reports published by the producer
+    uint32_t superseded; // published reports replaced by a newer one before they were sent
+    uint32_t sent;       // reports handed to the endpoint
+    uint32_t busy;       // sends refused because the endpoint was still busy
+  } report_stage_stats_t;
+
+  void report_stage_init(void);
+
+  /**
+   * @brief buffer for the next report, call report_stage_publish or report_stage_discard after
+   *
+   * Takes back a published report that has not been sent yet, the caller writes a
+   * complete report anyway. Only one producer may hold a buffer at a time.
+   */
+  tm_joystick_report *report_stage_begin(void);
+
+  // make the buffer from report_stage_begin the next one to send
+  void report_stage_publish(void);
+
+  // release the buffer from report_stage_begin without publishing it
+  void report_stage_discard(void);
+
+  /**
+   * @brief the report last handed to the endpoint, read only
+   *
+   * @return NULL before the first report was sent
+   */
+  const tm_joystick_report *report_stage_last_sent(void);
+
+  // whether a published report waits to be sent
+  bool report_stage_pending(void);
+
+  /**
+   * @brief hand the published report to the joystick IN endpoint, call from the USB core
+   *
+   * @return false if nothing was published or the endpoint is busy, the report stays published
+   */
+  bool report_stage_send(void);
+
+  void report_stage_get_stats(report_stage_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_report_stage_h */
@@ -0,0 +1,175 @@
+#include "tusb.h"
+#include "hardware/structs/scb.h"
+#include "scheduler.h"
+#include "profile.h"
+
+// alarms shorter than this cost more than they save, the loop just spins
+#define SCHEDULER_MIN_SLEEP_US 20
+// upper bound of a single sleep, only reached when every task is suspended
+#define SCHEDULER_MAX_SLEEP_US 100000
+
+typedef struct
+{
+  scheduler_task_fn_t fn;
+  scheduler_priority_t priority;
+  uint32_t due_us;
+  volatile bool woken;
+  scheduler_task_stats_t stats;
+} task_t;
+
+static task_t _tasks[SCHEDULER_MAX_TASKS];
+static int _count;
+static volatile alarm_id_t _alarm;
+
+static inline bool reached(uint32_t now, uint32_t due_us)
+{
+  return (int32_t)(now - due_us) >= 0;
+}
+
+static int64_t wake_alarm_cb(alarm_id_t id, void *user_data)
+{
+  (void)id;
+  (void)user_data;
+  _alarm = 0;
+  __sev();
+  return 0;
+}
+
+int scheduler_add(const char *name, scheduler_task_fn_t fn, uint32_t period_us, scheduler_priority_t priority)
+{
+  if (_count >= SCHEDULER_MAX_TASKS)
+    return -1;
+
+  task_t *t = &_tasks[_count];
+  t->fn = fn;
+  t->priority = priority;
+  t->due_us = time_us_32();
+  t->woken = false;
+  t->stats = (scheduler_task_stats_t){.name = name, .period_us = period_us};
+  return _count++;
+}
+
+void scheduler_set_period(int id, uint32_t period_us)
+{
+  if (id < 0 || id >= _count || _tasks[id].stats.period_us == period_us)
+    return;
+
+  // a new period starts counting now
+  _tasks[id].stats.period_us = period_us;
+  _tasks[id].due_us = time_us_32();
+}
+
+void scheduler_wake(int id)
+{
+  if (id < 0 || id >= _count)
+    return;
+
+  _tasks[id].woken = true;
+  __sev();
+}
+
+// most urgent task that is due: highest priority first, then the oldest due time
+static task_t *next_due(uint32_t now)
+{
+  task_t *best = NULL;
+
+  for (int i = 0; i < _count; ++i)
+  {
+    task_t *t = &_tasks[i];
+    if (!t->woken && (t->stats.period_us == 0 || !reached(now, t->due_us)))
+      continue;
+
+    if (!best || t->priority < best->priority ||
+        (t->priority == best->priority && (int32_t)(t->due_us - best->due_us) < 0))
+      best = t;
+  }
+  return best;
+}
+
+static void run_task(task_t *t, uint32_t now)
+{
+  const uint32_t period = t->stats.period_us;
+  const bool due = period && reached(now, t->due_us);
+  t->woken = false;
+
+  if (due)
+  {
+    uint32_t lateness = now - t->due_us;
+    if (lateness > t->stats.max_lateness_us)
+      t->stats.max_lateness_us = lateness;
+    if (lateness >= period)
+      t->stats.deadline_misses++;
+  }
+
+  t->fn();
+
+  uint32_t end = time_us_32();
+  if (end - now > t->stats.max_runtime_us)
+    t->stats.max_runtime_us = end - now;
+  t->stats.runs++;
+
+  if (due)
+  {
+    // keep the phase, but drop slots that were missed instead of running them back to back
+    t->due_us += period;
+    if (reached(end, t->due_us))
+      t->due_us = end + period;
+  }
+}
+
+static void sleep_until_due(uint32_t now)
+{
+  uint32_t wait = SCHEDULER_MAX_SLEEP_US;
+  for (int i = 0; i < _count; ++i)
+  {
+    if (_tasks[i].stats.period_us && _tasks[i].due_us - now < wait)
+      wait = _tasks[i].due_us - now;
+  }
+
+  if (wait < SCHEDULER_MIN_SLEEP_US)
+    return;
+
+  if (_alarm)
+    cancel_alarm(_alarm);
+  _alarm = add_alarm_in_us(wait, wake_alarm_cb, NULL, true);
+
+  // USB interrupts, the alarm and scheduler_wake all end the sleep
+  if (!tud_task_event_ready())
+    __wfe();
+}
+
+void scheduler_run(void)
+{
+  // let any interrupt that becomes pending set the event register, so an interrupt
+  // arriving between the last check and __wfe cannot be slept through
+  scb_hw->scr |= M0PLUS_SCR_SEVONPEND_BITS;
+
+  while (1)
+  {
+    // USB is serviced between any two tasks
+    PROFILE_BEGIN(PROFILE_TUD_TASK);
+    tud_task();
+    PROFILE_END(PROFILE_TUD_TASK);
+
+    uint32_t now = time_us_32();
+    task_t *t = next_due(now);
+    if (t)
+      run_task(t, now);
+    else
+      sleep_until_due(now);
+  }
+}
+
+bool scheduler_get_stats(int id, scheduler_task_stats_t *stats)
+{
+  if (id < 0 || id >= _count)
+    return false;
+
+  *stats = _tasks[id].stats;
+  return true;
+}
+
+int scheduler_task_count(void)
+{
+  return _count;
+}
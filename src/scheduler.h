@@ -0,0 +1,67 @@
+#ifndef _tmext_scheduler_h
+#define _tmext_scheduler_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+  // Lower value runs first when several tasks are due. USB is serviced
+  // between any two tasks and is not a task of its own.
+  typedef enum
+  {
+    SCHEDULER_PRIORITY_HIGH,   // input acquisition and HID reports
+    SCHEDULER_PRIORITY_NORMAL, // display
+    SCHEDULER_PRIORITY_LOW     // housekeeping, status LED
+  } scheduler_priority_t;
+
+  typedef void (*scheduler_task_fn_t)(void);
+
+  typedef struct
+  {
+    const char *name;
+    uint32_t period_us;
+    uint32_t runs;            // completed runs since boot
+    uint32_t deadline_misses; // runs started after their period had already elapsed again
+    uint32_t max_lateness_us; // longest delay between due time and start
+    uint32_t max_runtime_us;  // longest single run
+  } scheduler_task_stats_t;
+
+  /**
+   * @brief register a periodic task, the first run is due immediately
+   *
+   * @return task id, or -1 if all SCHEDULER_MAX_TASKS slots are taken
+   */
+  int scheduler_add(const char *name, scheduler_task_fn_t fn, uint32_t period_us, scheduler_priority_t priority);
+
+  /**
+   * @brief change the period, a period of 0 suspends the task
+   */
+  void scheduler_set_period(int id, uint32_t period_us);
+
+  /**
+   * @brief make a task due now, safe to call from interrupt handlers
+   */
+  void scheduler_wake(int id);
+
+  /**
+   * @brief run tasks by deadline and priority forever, sleeps with __wfe while nothing is due
+   */
+  void scheduler_run(void) __attribute__((noreturn));
+
+  bool scheduler_get_stats(int id, scheduler_task_stats_t *stats);
+
+  // number of registered tasks, ids are 0 to count - 1
+  int scheduler_task_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_scheduler_h */
@@ -0,0 +1,52 @@
+#ifndef _tmext_seqlock_h
+#define _tmext_seqlock_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+  // Sequence lock for a latest-value slot with a single writer.
+  // The writer never waits, readers retry when they raced with a write.
+  // Works between cores and between IRQ and thread context.
+  typedef struct
+  {
+    volatile uint32_t sequence;
+  } seqlock_t;
+
+  static inline void seqlock_write_begin(seqlock_t *lock)
+  {
+    lock->sequence++;
+    __dmb();
+  }
+
+  static inline void seqlock_write_end(seqlock_t *lock)
+  {
+    __dmb();
+    lock->sequence++;
+  }
+
+  static inline uint32_t seqlock_read_begin(const seqlock_t *lock)
+  {
+    uint32_t sequence;
+    while ((sequence = lock->sequence) & 1u)
+    {
+      tight_loop_contents();
+    }
+    __dmb();
+    return sequence;
+  }
+
+  static inline bool seqlock_read_retry(const seqlock_t *lock, uint32_t sequence)
+  {
+    __dmb();
+    return lock->sequence != sequence;
+  }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_seqlock_h */
@@ -0,0 +1,151 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#if TM_SENSOR_ON_CORE1
+#include "pico/multicore.h"
+#endif
+
+#include "usb_descriptors.h"
+#include "hid_reporter.h"
+#include "hall_sensor.h"
+#include "display_task.h"
+#include "settings.h"
+
+#define SETTINGS_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define SETTINGS_FLASH_PAGES ((sizeof(tm_settings_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE)
+
+_Static_assert(sizeof(tm_settings_t) <= FLASH_SECTOR_SIZE, "settings exceed their flash sector");
+
+static tm_settings_t _settings;
+
+// over the first len bytes, the checksum follows them
+static uint32_t checksum(const void *settings, size_t len)
+{
+  const uint8_t *bytes = (const uint8_t *)settings;
+  uint32_t a = 1;
+  uint32_t b = 0;
+
+  for (size_t i = 0; i < len; i++)
+  {
+    a = (a + bytes[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+static void set_defaults(tm_settings_t *settings)
+{
+  memset(settings, 0, sizeof(*settings));
+  settings->magic = SETTINGS_MAGIC;
+  settings->version = SETTINGS_VERSION;
+  settings->size = sizeof(*settings);
+  settings->poll_interval_ms = HID_POLL_INTERVAL_MS;
+  settings->min_report_interval_us = HID_REPORTER_DEFAULT_MIN_INTERVAL_US;
+  settings->filter_shift = HALL_SENSOR_DEFAULT_FILTER_SHIFT;
+  settings->display_mode = DISPLAY_TASK_DEFAULT_MODE;
+  settings->axis_count = TM_JOYSTICK_AXIS_COUNT;
+  for (uint8_t axis = 0; axis < TM_JOYSTICK_AXIS_COUNT; axis++)
+  {
+    int32_t in_min, in_max;
+    tm_joystick_getAxisRange(axis, &in_min, &in_max);
+    config_axis_defaults(&settings->axes[axis], in_min, in_max);
+  }
+}
+
+bool settings_valid_poll_interval(uint8_t interval_ms)
+{
+  return interval_ms == 1 || interval_ms == 2 || interval_ms == 4 || interval_ms == 8;
+}
+
+void settings_init(void)
+{
+  const tm_settings_t *stored = (const tm_settings_t *)(XIP_BASE + SETTINGS_FLASH_OFFSET);
+
+  set_defaults(&_settings);
+
+  if (stored->magic != SETTINGS_MAGIC || stored->size < offsetof(tm_settings_t, filter_shift) + sizeof(uint32_t) ||
+      stored->size > FLASH_SECTOR_SIZE)
+    return;
+
+  // the checksum is the last field of every layout
+  const size_t len = stored->size - sizeof(uint32_t);
+  uint32_t stored_checksum;
+  memcpy(&stored_checksum, (const uint8_t *)stored + len, sizeof(stored_checksum));
+  if (stored_checksum != checksum(stored, len))
+    return;
+
+  // fields the writer did not know keep their defaults
+  memcpy(&_settings, stored, len < offsetof(tm_settings_t, checksum) ? len : offsetof(tm_settings_t, checksum));
+  _settings.version = SETTINGS_VERSION;
+  _settings.size = sizeof(_settings);
+
+  if (!settings_valid_poll_interval(_settings.poll_interval_ms))
+    _settings.poll_interval_ms = HID_POLL_INTERVAL_MS;
+
+  // axes of another joystick layout do not apply
+  if (_settings.axis_count != TM_JOYSTICK_AXIS_COUNT)
+  {
+    tm_settings_t defaults;
+    set_defaults(&defaults);
+    _settings.axis_count = TM_JOYSTICK_AXIS_COUNT;
+    memcpy(_settings.axes, defaults.axes, sizeof(_settings.axes));
+  }
+}
+
+const tm_settings_t *settings_get(void)
+{
+  return &_settings;
+}
+
+bool settings_set_poll_interval(uint8_t interval_ms)
+{
+  if (!settings_valid_poll_interval(interval_ms))
+    return false;
+
+  _settings.poll_interval_ms = interval_ms;
+  return true;
+}
+
+void settings_set_min_report_interval(uint32_t interval_us)
+{
+  _settings.min_report_interval_us = interval_us;
+}
+
+void settings_set_filter_shift(uint8_t shift)
+{
+  _settings.filter_shift = shift;
+}
+
+void settings_set_display_mode(uint8_t mode)
+{
+  _settings.display_mode = mode;
+}
+
+void settings_set_axis(uint8_t axis, const config_axis_t *config)
+{
+  if (axis < TM_JOYSTICK_AXIS_COUNT)
+    _settings.axes[axis] = *config;
+}
+
+void settings_save(void)
+{
+  static uint8_t page[SETTINGS_FLASH_PAGES * FLASH_PAGE_SIZE];
+
+  _settings.checksum = checksum(&_settings, offsetof(tm_settings_t, checksum));
+  memset(page, 0xff, sizeof(page));
+  memcpy(page, &_settings, sizeof(_settings));
+
+#if TM_SENSOR_ON_CORE1
+  // core 1 must not execute from flash while it is erased
+  multicore_lockout_start_blocking();
+#endif
+  uint32_t interrupts = save_and_disable_interrupts();
+  flash_range_erase(SETTINGS_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+  flash_range_program(SETTINGS_FLASH_OFFSET, page, sizeof(page));
+  restore_interrupts(interrupts);
+#if TM_SENSOR_ON_CORE1
+  multicore_lockout_end_blocking();
+#endif
+}
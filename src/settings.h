@@ -0,0 +1,68 @@
+#ifndef _tmext_settings_h
+#define _tmext_settings_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "joystick.h"
+#include "config_protocol.h"
+
+#define SETTINGS_MAGIC 0x544d3136 // "TM16"
+#define SETTINGS_VERSION 2
+
+  // Persisted in the last flash sector, fields are only ever appended. Settings of an
+  // older, shorter layout are loaded and the appended fields keep their defaults.
+  typedef struct
+  {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;               // sizeof(tm_settings_t) of the writer
+    uint8_t poll_interval_ms;    // HID IN endpoint interval, 1, 2, 4 or 8
+    uint8_t reserved[3];
+    uint32_t min_report_interval_us;
+    // version 2
+    uint8_t filter_shift;        // hall sensor smoothing
+    uint8_t display_mode;
+    uint8_t axis_count;          // entries of axes, TM_JOYSTICK_AXIS_COUNT of the writer
+    uint8_t reserved2;
+    config_axis_t axes[TM_JOYSTICK_AXIS_COUNT];
+    uint32_t checksum;           // over all bytes before this field, always the last one
+  } tm_settings_t;
+
+  /**
+   * @brief load persisted settings, falls back to build time defaults if flash is blank or invalid
+   */
+  void settings_init(void);
+
+  const tm_settings_t *settings_get(void);
+
+  /**
+   * @brief change the advertised polling interval, takes effect on the next enumeration
+   *
+   * @return false if interval is not 1, 2, 4 or 8
+   */
+  bool settings_set_poll_interval(uint8_t interval_ms);
+
+  void settings_set_min_report_interval(uint32_t interval_us);
+
+  void settings_set_filter_shift(uint8_t shift);
+
+  void settings_set_display_mode(uint8_t mode);
+
+  void settings_set_axis(uint8_t axis, const config_axis_t *config);
+
+  /**
+   * @brief write current settings to flash
+   */
+  void settings_save(void);
+
+  bool settings_valid_poll_interval(uint8_t interval_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_settings_h */
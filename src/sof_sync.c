@@ -0,0 +1,69 @@
+#include "sof_sync.h"
+
+// frame numbers are 11 bits
+#define FRAME_MASK 0x7ff
+// later observations move the estimate by at most this much, more than the
+// 500 ppm the USB spec allows between the host and the local clock
+#define SOF_SYNC_CREEP_US 1
+// without a SOF for this long the bus is suspended or gone
+#define SOF_SYNC_TIMEOUT_US 10000
+
+static uint32_t _frame;
+static uint32_t _last_seen_us;
+static sof_sync_stats_t _stats;
+
+void sof_sync_frame(uint32_t frame_count, uint32_t now_us)
+{
+  frame_count &= FRAME_MASK;
+
+  if (_stats.frames == 0 || now_us - _last_seen_us > SOF_SYNC_TIMEOUT_US)
+  {
+    // start over, e.g. after resume
+    _stats.frames = 0;
+    _stats.sof_us = now_us;
+  }
+  else
+  {
+    const uint32_t elapsed = (frame_count - _frame) & FRAME_MASK;
+    const uint32_t predicted = _stats.sof_us + elapsed * SOF_SYNC_FRAME_US;
+    const int32_t late = (int32_t)(now_us - predicted);
+
+    if (elapsed > 1)
+      _stats.missed += elapsed - 1;
+
+    if (late < 0)
+    {
+      // an observation can only be late, so the estimate was
+      _stats.sof_us = now_us;
+    }
+    else
+    {
+      _stats.sof_us = predicted + (late > SOF_SYNC_CREEP_US ? SOF_SYNC_CREEP_US : (uint32_t)late);
+      if ((uint32_t)late > _stats.max_latency_us)
+        _stats.max_latency_us = late;
+    }
+  }
+
+  _frame = frame_count;
+  _last_seen_us = now_us;
+  _stats.frames++;
+}
+
+bool sof_sync_locked(void)
+{
+  return _stats.frames >= SOF_SYNC_LOCK_FRAMES && time_us_32() - _last_seen_us < SOF_SYNC_TIMEOUT_US;
+}
+
+uint32_t sof_sync_next(uint32_t t_us)
+{
+  const int32_t ahead = (int32_t)(t_us - _stats.sof_us);
+  if (ahead <= 0)
+    return _stats.sof_us;
+
+  return _stats.sof_us + ((uint32_t)ahead + SOF_SYNC_FRAME_US - 1) / SOF_SYNC_FRAME_US * SOF_SYNC_FRAME_US;
+}
+
+void sof_sync_get_stats(sof_sync_stats_t *stats)
+{
+  *stats = _stats;
+}
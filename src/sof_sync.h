@@ -0,0 +1,52 @@
+#ifndef _tmext_sof_sync_h
+#define _tmext_sof_sync_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+// Full speed frames are 1 ms of the host clock
+#define SOF_SYNC_FRAME_US 1000
+
+// observations before the phase is trusted
+#ifndef SOF_SYNC_LOCK_FRAMES
+#define SOF_SYNC_LOCK_FRAMES 16
+#endif
+
+  typedef struct
+  {
+    uint32_t frames;          // SOFs observed
+    uint32_t missed;          // frames between observations that were not seen
+    uint32_t max_latency_us;  // longest delay of an observation behind the estimate
+    uint32_t sof_us;          // estimated time of the latest SOF
+  } sof_sync_stats_t;
+
+  /**
+   * @brief feed one start of frame, call from tud_sof_cb
+   *
+   * tud_sof_cb runs from tud_task, so observations arrive late by a varying amount.
+   * The estimate follows the earliest observations immediately and later ones only
+   * slowly, which tracks the frame phase and the drift between host and local clock.
+   */
+  void sof_sync_frame(uint32_t frame_count, uint32_t now_us);
+
+  /**
+   * @brief whether the frame phase is known, false before enumeration and while suspended
+   */
+  bool sof_sync_locked(void);
+
+  /**
+   * @brief predicted time of the first SOF at or after t_us, only meaningful when locked
+   */
+  uint32_t sof_sync_next(uint32_t t_us);
+
+  void sof_sync_get_stats(sof_sync_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_sof_sync_h */
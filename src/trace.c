@@ -0,0 +1,109 @@
+#include <string.h>
+
+#include "hardware/sync.h"
+#include "trace.h"
+
+#if TM_TRACE
+
+#define TRACE_RING_MASK (TRACE_RING_EVENTS - 1)
+
+#if TRACE_RING_EVENTS & TRACE_RING_MASK
+#error "TRACE_RING_EVENTS must be a power of two"
+#endif
+
+// each ring is written by its own core only, interrupts are masked for the few stores
+// of one event so an interrupt on the same core cannot interleave with it
+static trace_event_t _rings[TRACE_CORES][TRACE_RING_EVENTS];
+static uint32_t _heads[TRACE_CORES];
+static volatile bool _frozen;
+
+void trace_event(trace_type_t type, uint16_t payload)
+{
+  if (_frozen)
+    return;
+
+  const uint core = get_core_num();
+  uint32_t status = save_and_disable_interrupts();
+  trace_event_t *e = &_rings[core][_heads[core]++ & TRACE_RING_MASK];
+  e->timestamp_us = time_us_32();
+  e->type = (uint8_t)type;
+  e->core = (uint8_t)core;
+  e->payload = payload;
+  restore_interrupts(status);
+}
+
+bool trace_enabled(void)
+{
+  return true;
+}
+
+void trace_freeze(bool frozen)
+{
+  if (!frozen)
+    memset(_heads, 0, sizeof(_heads));
+  __dmb();
+  _frozen = frozen;
+}
+
+bool trace_frozen(void)
+{
+  return _frozen;
+}
+
+uint32_t trace_recorded(uint8_t core)
+{
+  return core < TRACE_CORES ? _heads[core] : 0;
+}
+
+uint32_t trace_read(uint8_t core, uint32_t first, trace_event_t *events, uint32_t max)
+{
+  if (!_frozen || core >= TRACE_CORES)
+    return 0;
+
+  const uint32_t head = _heads[core];
+  const uint32_t count = head < TRACE_RING_EVENTS ? head : TRACE_RING_EVENTS;
+  if (first >= count)
+    return 0;
+  if (max > count - first)
+    max = count - first;
+
+  // the oldest event sits at the head once the ring has wrapped
+  const uint32_t start = head - count + first;
+  for (uint32_t i = 0; i < max; ++i)
+    events[i] = _rings[core][(start + i) & TRACE_RING_MASK];
+  return max;
+}
+
+#else
+
+bool trace_enabled(void)
+{
+  return false;
+}
+
+void trace_freeze(bool frozen)
+{
+  (void)frozen;
+}
+
+bool trace_frozen(void)
+{
+  return false;
+}
+
+uint32_t trace_recorded(uint8_t core)
+{
+  (void)core;
+  return 0;
+}
+
+uint32_t trace_read(uint8_t core, uint32_t first, trace_event_t *events, uint32_t max)
+{
+  (void)core;
+  (void)first;
+  (void)events;
+  (void)max;
+  return 0;
+}
+
+#endif
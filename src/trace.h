@@ -0,0 +1,87 @@
+#ifndef _tmext_trace_h
+#define _tmext_trace_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+
+// Binary event trace, one ring per core so both cores record without a shared lock.
+// Events carry time_us_32, which both cores read from the same timer.
+// With TM_TRACE unset trace_event compiles to nothing and the rings are empty.
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS 512 // per core, power of two
+#endif
+
+#define TRACE_CORES 2
+
+  typedef enum
+  {
+    TRACE_SAMPLE_ACQUIRED = 1, // payload: sample sequence
+    TRACE_SENSOR_INVALID,      // frame dropped on checksum or framing error
+    TRACE_REPORT_QUEUED,       // payload: reports sent
+    TRACE_REPORT_COMPLETE,     // payload: reports completed
+    TRACE_SOF,                 // payload: USB frame number
+    TRACE_FRAME_BEGIN,         // payload: display mode
+    TRACE_FRAME_END,           // payload: display mode
+    TRACE_SENSOR_READ_START,   // asynchronous sensor read started
+    TRACE_SAMPLE_AGE,          // payload: sample age in us when the host took the report, saturating
+    TRACE_BUTTON_EVENT,        // payload: button, bit 8 set for a press
+    TRACE_TYPE_COUNT
+  } trace_type_t;
+
+  // 8 bytes, the same layout is sent to the host
+  typedef struct
+  {
+    uint32_t timestamp_us;
+    uint8_t type;
+    uint8_t core;
+    uint16_t payload;
+  } trace_event_t;
+
+#if TM_TRACE
+
+  /**
+   * @brief record an event on the ring of the calling core, safe from interrupt handlers
+   */
+  void trace_event(trace_type_t type, uint16_t payload);
+
+#else
+
+  static inline void trace_event(trace_type_t type, uint16_t payload)
+  {
+    (void)type;
+    (void)payload;
+  }
+
+#endif
+
+  bool trace_enabled(void);
+
+  /**
+   * @brief stop or restart recording, restarting empties the rings
+   *
+   * A dump freezes first, so the rings hold still while they are read.
+   */
+  void trace_freeze(bool frozen);
+
+  bool trace_frozen(void);
+
+  // events recorded by a core since the last restart, older ones than TRACE_RING_EVENTS are overwritten
+  uint32_t trace_recorded(uint8_t core);
+
+  /**
+   * @brief copy events of a frozen ring, oldest first
+   *
+   * @return number of events copied, 0 past the end or while recording
+   */
+  uint32_t trace_read(uint8_t core, uint32_t first, trace_event_t *events, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_trace_h */
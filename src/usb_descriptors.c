@@ -25,18 +25,35 @@
 
 #include "tusb.h"
 #include "usb_descriptors.h"
+#include "settings.h"
+#include "usb_diagnostics.h"
+#include "button_events.h"
+#include "axis_scale.h"
+#include "config_protocol.h"
 #include <pico/stdlib.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* A combination of interfaces must have a unique product id, since PC will save device driver after the first plug.
  * Same VID/PID with different interface e.g MSC (first), then CDC (later) will possibly cause system error on PC.
  *
  * Auto ProductID layout's Bitmap:
- *   [MSB]         HID | MSC | CDC          [LSB]
+ *   [MSB]  DIAG | EXTENDED | POLL INTERVAL (2 bits) | VENDOR | MIDI | HID | MSC | CDC  [LSB]
+ *
+ * The polling interval is part of the PID so the host does not reuse a cached configuration descriptor,
+ * the extended joystick layout so it does not apply the calibration of the other layout.
+ * DIAG is the second HID interface, an interface count must not spill into the MIDI bit.
  */
-#define _PID_MAP(itf, n) ((CFG_TUD_##itf) << (n))
+#define _PID_MAP(itf, n) ((CFG_TUD_##itf ? 1 : 0) << (n))
+#define _PID_DIAG ((CFG_TUD_HID > 1 ? 1 : 0) << 8)
 #define USB_PID (0x4000 | _PID_MAP(CDC, 0) | _PID_MAP(MSC, 1) | _PID_MAP(HID, 2) | \
-                 _PID_MAP(MIDI, 3) | _PID_MAP(VENDOR, 4))
+                 _PID_MAP(MIDI, 3) | _PID_MAP(VENDOR, 4) | _PID_DIAG)
+#define _PID_INTERVAL_SHIFT 5
+#if TM_JOYSTICK_EXTENDED
+#define _PID_EXTENDED 0x80
+#else
+#define _PID_EXTENDED 0x00
+#endif
 
 #define USB_VID 0xCafe
 #define USB_BCD 0x0200
@@ -44,7 +61,7 @@
 //--------------------------------------------------------------------+
 // Device Descriptors
 //--------------------------------------------------------------------+
-tusb_desc_device_t const desc_device =
+tusb_desc_device_t desc_device =
     {
         .bLength = sizeof(tusb_desc_device_t),
         .bDescriptorType = TUSB_DESC_DEVICE,
@@ -68,6 +85,9 @@ tusb_desc_device_t const desc_device =
 // Application return pointer to descriptor
 uint8_t const *tud_descriptor_device_cb(void)
 {
+  // 1 ms -> 0, 2 ms -> 1, 4 ms -> 2, 8 ms -> 3
+  uint16_t interval_code = (uint16_t)(31 - __builtin_clz(usb_hid_poll_interval_ms()));
+  desc_device.idProduct = USB_PID | _PID_EXTENDED | (interval_code << _PID_INTERVAL_SHIFT);
   return (uint8_t const *)&desc_device;
 }
 
@@ -79,13 +99,25 @@ uint8_t const desc_hid_report[] =
     {
         TUD_HID_REPORT_DESC_JOYSTICK()};
 
+uint8_t const desc_diag_report[] =
+    {
+        TUD_HID_REPORT_DESC_DIAGNOSTICS(DIAG_PAYLOAD_SIZE,
+                                        TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_PROFILE, 0x01)
+                                            TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_HISTOGRAM, 0x02)
+                                                TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_TRACE, 0x03)
+                                                    TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_TRACE_DATA, 0x04)
+                                                        TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_LATENCY, 0x05)
+                                                            TUD_HID_REPORT_DESC_DIAG_FEATURE(DIAG_REPORT_HOST_REQUESTS, 0x06)
+                                                                TUD_HID_REPORT_DESC_DIAG_FEATURE(CONFIG_REPORT_DEVICE, 0x07)
+                                                                    TUD_HID_REPORT_DESC_DIAG_FEATURE(CONFIG_REPORT_AXIS, 0x08)
+                                                                        TUD_HID_REPORT_DESC_DIAG_FEATURE(CONFIG_REPORT_COMMAND, 0x09))};
+
 // Invoked when received GET HID REPORT DESCRIPTOR
 // Application return pointer to descriptor
 // Descriptor contents must exist long enough for transfer to complete
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
 {
-  (void)instance;
-  return desc_hid_report;
+  return instance == HID_INSTANCE_DIAG ? desc_diag_report : desc_hid_report;
 }
 
 //--------------------------------------------------------------------+
@@ -95,20 +127,35 @@ uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
 enum
 {
   ITF_NUM_HID,
+  ITF_NUM_DIAG,
   ITF_NUM_TOTAL
 };
 
-#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
+#define CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + 2 * TUD_HID_DESC_LEN)
+
+// a report has to fit one packet, the diagnostics interface only uses feature reports on EP0
+#if TM_JOYSTICK_EXTENDED
+#define HID_EP_SIZE 64
+#else
+#define HID_EP_SIZE 16
+#endif
+_Static_assert(sizeof(tm_joystick_report) <= HID_EP_SIZE, "joystick report exceeds one packet");
+#define DIAG_EP_SIZE 16
+#define DIAG_POLL_INTERVAL_MS 10
 
-#define EPNUM_HID 0x81
+// bInterval is the last byte of the HID endpoint descriptor
+#define HID_EP_INTERVAL_OFFSET (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN - 1)
 
-uint8_t const desc_configuration[] =
+uint8_t desc_configuration[] =
     {
         // Config number, interface count, string index, total length, attribute, power in mA
         TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
 
         // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval
-        TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, /*113*/ sizeof(desc_hid_report), EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, 5)};
+        TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, /*113*/ sizeof(desc_hid_report), EPNUM_HID, HID_EP_SIZE, HID_POLL_INTERVAL_MS),
+
+        // Vendor defined diagnostics, stays after the joystick so HID_EP_INTERVAL_OFFSET is unchanged
+        TUD_HID_DESCRIPTOR(ITF_NUM_DIAG, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_diag_report), EPNUM_DIAG, DIAG_EP_SIZE, DIAG_POLL_INTERVAL_MS)};
 
 #if TUD_OPT_HIGH_SPEED
 // Per USB specs: high speed capable device must report device_qualifier and other_speed_configuration
@@ -164,6 +211,8 @@ uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 {
   (void)index; // for multiple configurations
 
+  desc_configuration[HID_EP_INTERVAL_OFFSET] = usb_hid_poll_interval_ms();
+
   // This example use the same configuration for both high and full speed mode
   return desc_configuration;
 }
@@ -224,6 +273,11 @@ uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
   return _desc_str;
 }
 
+uint8_t usb_hid_poll_interval_ms(void)
+{
+  return settings_get()->poll_interval_ms;
+}
+
 //--------------------------------------------------------------------+
 // JOYSTICK IMPLEMENTATION
 //--------------------------------------------------------------------+
@@ -247,7 +301,24 @@ uint16_t const *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
 #define JOYSTICK_INCLUDE_BRAKE 0B00001000
 #define JOYSTICK_INCLUDE_STEERING 0B00010000
 
-#define TM_REPORT_SIZE 4 + 1 + 8 // 32 buttons -> 4bytes, 2 hats -> 1 byte, 4 axis * 2 bytes
+_Static_assert(TM_JOYSTICK_HAT_COUNT % 2 == 0, "hats are packed two per byte");
+
+// report scaling by TM_JOYSTICK_AXIS_* index, set up by tm_joystick_setup
+static axis_scale_t _axisScales[TM_JOYSTICK_AXIS_COUNT];
+// deadzones and curves, identity until tm_joystick_configureAxis
+static axis_shape_t _axisShapes[TM_JOYSTICK_AXIS_COUNT];
+
+// input range and report width by axis index
+static const struct
+{
+  int32_t in_min;
+  int32_t in_max;
+  uint8_t bits;
+} _axisLayout[TM_JOYSTICK_AXIS_COUNT] = {
+#define _AXIS_LAYOUT(name, page, usage, bits, in_min, in_max) {in_min, in_max, bits},
+    TM_JOYSTICK_AXES(_AXIS_LAYOUT)
+#undef _AXIS_LAYOUT
+};
 
 long map(long x, long in_min, long in_max, long out_min, long out_max)
 {
@@ -256,38 +327,16 @@ long map(long x, long in_min, long in_max, long out_min, long out_max)
 
 void tm_joystick_setup()
 {
-  // set defaults
-  tm_joystick._buttonValues = NULL;
-  tm_joystick._buttonValuesArraySize = 0;
-
-  // Save Joystick Settings
-  tm_joystick._buttonCount = JOYSTICK_DEFAULT_BUTTON_COUNT;
-  tm_joystick._hatSwitchCount = JOYSTICK_DEFAULT_HATSWITCH_COUNT;
-
-  // Setup Joystick State
-  if (JOYSTICK_DEFAULT_BUTTON_COUNT > 0)
+  // Initialize Joystick State, the table range maps to the full logical range of the report field
+  for (int index = 0; index < TM_JOYSTICK_AXIS_COUNT; index++)
   {
-    tm_joystick._buttonValuesArraySize = tm_joystick._buttonCount / 8;
-    if ((tm_joystick._buttonCount % 8) > 0)
-    {
-      tm_joystick._buttonValuesArraySize++;
-    }
-    tm_joystick._buttonValues = malloc(sizeof(uint8_t[tm_joystick._buttonValuesArraySize]));
+    tm_joystick_configureAxis(index, _axisLayout[index].in_min, _axisLayout[index].in_max, 0, 0, NULL);
+    tm_joystick._axisValues[index] = 0;
   }
-
-  // Initialize Joystick State
-  tm_joystick._xAxis = 0;
-  tm_joystick._yAxis = 0;
-  tm_joystick._zAxis = 0;
-  tm_joystick._slider = 0;
-  for (int index = 0; index < JOYSTICK_HATSWITCH_COUNT_MAXIMUM; index++)
+  for (int index = 0; index < TM_JOYSTICK_HAT_COUNT; index++)
   {
     tm_joystick._hatSwitchValues[index] = JOYSTICK_HATSWITCH_RELEASE;
   }
-  for (int index = 0; index < tm_joystick._buttonValuesArraySize; index++)
-  {
-    tm_joystick._buttonValues[index] = 0;
-  }
 }
 
 void tm_joystick_setButton(uint8_t button, uint8_t value)
@@ -302,51 +351,54 @@ void tm_joystick_setButton(uint8_t button, uint8_t value)
   }
 }
 
+// Button changes are latched, a press is reported even when it is released before the next report
 void tm_joystick_pressButton(uint8_t button)
 {
-  if (button >= JOYSTICK_DEFAULT_BUTTON_COUNT)
+  if (button >= TM_JOYSTICK_BUTTON_COUNT)
     return;
 
-  int index = button / 8;
-  int bit = button % 8;
-
-  bitSet(tm_joystick._buttonValues[index], bit);
+  button_events_set(button, true);
 }
 
 void tm_joystick_releaseButton(uint8_t button)
 {
-  if (button >= JOYSTICK_DEFAULT_BUTTON_COUNT)
+  if (button >= TM_JOYSTICK_BUTTON_COUNT)
     return;
 
-  int index = button / 8;
-  int bit = button % 8;
-
-  bitClear(tm_joystick._buttonValues[index], bit);
+  button_events_set(button, false);
 }
 
 void tm_joystick_setXAxis(int32_t value)
 {
-  tm_joystick._xAxis = value;
+  tm_joystick._axisValues[TM_JOYSTICK_AXIS_x] = value;
 }
 
 void tm_joystick_setYAxis(int32_t value)
 {
-  tm_joystick._yAxis = value;
+  tm_joystick._axisValues[TM_JOYSTICK_AXIS_y] = value;
 }
 
 void tm_joystick_setZAxis(int32_t value)
 {
-  tm_joystick._zAxis = value;
+  tm_joystick._axisValues[TM_JOYSTICK_AXIS_z] = value;
 }
 
 void tm_joystick_setSliderAxis(int32_t value)
 {
-  tm_joystick._slider = value;
+  tm_joystick._axisValues[TM_JOYSTICK_AXIS_s] = value;
+}
+
+void tm_joystick_setAxis(uint8_t axis, int32_t value)
+{
+  if (axis >= TM_JOYSTICK_AXIS_COUNT)
+    return;
+
+  tm_joystick._axisValues[axis] = value;
 }
 
 void tm_joystick_setHatSwitch(int8_t hatSwitchIndex, int16_t value)
 {
-  if (hatSwitchIndex >= JOYSTICK_DEFAULT_HATSWITCH_COUNT)
+  if (hatSwitchIndex < 0 || hatSwitchIndex >= TM_JOYSTICK_HAT_COUNT)
   {
     return;
   }
@@ -354,6 +406,39 @@ void tm_joystick_setHatSwitch(int8_t hatSwitchIndex, int16_t value)
   tm_joystick._hatSwitchValues[hatSwitchIndex] = value;
 }
 
+void tm_joystick_configureAxis(uint8_t axis, int32_t inFrom, int32_t inTo, uint16_t deadzoneCenter, uint16_t deadzoneEdge, const uint16_t *curve)
+{
+  if (axis >= TM_JOYSTICK_AXIS_COUNT)
+    return;
+
+  axis_scale_init(&_axisScales[axis], inFrom, inTo, 0, (1l << _axisLayout[axis].bits) - 1);
+  axis_shape_init(&_axisShapes[axis], deadzoneCenter, deadzoneEdge, curve);
+}
+
+bool tm_joystick_checkAxisRange(uint8_t axis, int32_t inFrom, int32_t inTo)
+{
+  if (axis >= TM_JOYSTICK_AXIS_COUNT)
+    return false;
+
+  axis_scale_t scale;
+  axis_scale_init(&scale, inFrom, inTo, 0, (1l << _axisLayout[axis].bits) - 1);
+  return scale.multiplier != 0;
+}
+
+void tm_joystick_getAxisRange(uint8_t axis, int32_t *inMin, int32_t *inMax)
+{
+  *inMin = axis < TM_JOYSTICK_AXIS_COUNT ? _axisLayout[axis].in_min : 0;
+  *inMax = axis < TM_JOYSTICK_AXIS_COUNT ? _axisLayout[axis].in_max : 0;
+}
+
+void tm_joystick_getAxes(int32_t *x, int32_t *y, int32_t *z, int32_t *slider)
+{
+  *x = tm_joystick._axisValues[TM_JOYSTICK_AXIS_x];
+  *y = tm_joystick._axisValues[TM_JOYSTICK_AXIS_y];
+  *z = tm_joystick._axisValues[TM_JOYSTICK_AXIS_z];
+  *slider = tm_joystick._axisValues[TM_JOYSTICK_AXIS_s];
+}
+
 int buildAndSet16BitValue(int32_t value, int32_t valueMinimum, int32_t valueMaximum, int32_t actualMinimum, int32_t actualMaximum, uint8_t dataLocation[])
 {
   int32_t convertedValue;
@@ -393,43 +478,55 @@ int buildAndSetAxisValue(int32_t axisValue, int32_t axisMinimum, int32_t axisMax
   return buildAndSet16BitValue(axisValue, axisMinimum, axisMaximum, JOYSTICK_AXIS_MINIMUM, JOYSTICK_AXIS_MAXIMUM, dataLocation);
 }
 
-void tm_joystick_fill_report(tm_joystick_report *report)
+// fixed point counterpart of buildAndSetAxisValue, range and shape come from tm_joystick_configureAxis
+static inline void putAxisValue(const axis_scale_t *scale, const axis_shape_t *shape, int32_t axisValue, uint8_t dataLocation[], int bits)
 {
-  int index = 0;
+  uint32_t convertedValue = (uint32_t)axis_shape_apply(shape, axis_scale_apply(scale, axisValue), bits);
 
-  // Load Button State
-  for (; index < tm_joystick._buttonValuesArraySize; index++)
-  {
-    report->buttons[index] = tm_joystick._buttonValues[index];
-  }
+  dataLocation[0] = (uint8_t)(convertedValue & 0x00FF);
+  if (bits > 8)
+    dataLocation[1] = (uint8_t)(convertedValue >> 8);
+}
 
-  // Set Hat Switch Values
-  if (JOYSTICK_DEFAULT_HATSWITCH_COUNT > 0)
-  {
+// hat angle in degrees to a direction, negative is released
+static inline uint8_t hatDirection(int16_t value)
+{
+  return value < 0 ? HAT_DIR_C : (uint8_t)((value % 360) / 45);
+}
 
-    // Calculate hat-switch values
-    uint8_t convertedHatSwitch[JOYSTICK_HATSWITCH_COUNT_MAXIMUM];
-    for (int hatSwitchIndex = 0; hatSwitchIndex < JOYSTICK_HATSWITCH_COUNT_MAXIMUM; hatSwitchIndex++)
-    {
-      if (tm_joystick._hatSwitchValues[hatSwitchIndex] < 0)
-      {
-        convertedHatSwitch[hatSwitchIndex] = 8;
-      }
-      else
-      {
-        convertedHatSwitch[hatSwitchIndex] = (tm_joystick._hatSwitchValues[hatSwitchIndex] % 360) / 45;
-      }
-    }
+_Static_assert(TM_JOYSTICK_BUTTON_BYTES <= sizeof(uint32_t[BUTTON_EVENTS_WORDS]), "button bitmap covers the report");
 
-    // Pack hat-switch states into a single byte
-    report->hat[0] = (uint8_t)(convertedHatSwitch[1] << 4) | (0B00001111 & convertedHatSwitch[0]);
+// button changes included in the last filled report
+static uint32_t _reportButtonEvents;
 
-  } // Hat Switches
+// Every field is written by its own statement generated from the layout table in
+// joystick.h, all offsets and widths are constants.
+void tm_joystick_fill_report(tm_joystick_report *report)
+{
+  // Load Button State, the little endian words already are the report's bit order
+  uint32_t buttons[BUTTON_EVENTS_WORDS];
+  _reportButtonEvents = button_events_collect(buttons);
+  memcpy(report->buttons, buttons, TM_JOYSTICK_BUTTON_BYTES);
+
+  // Pack hat-switch states, even hats in the low nibble
+#define _FILL_HAT(index)                                                                      \
+  if ((index) % 2 == 0)                                                                       \
+    report->hat[(index) / 2] = hatDirection(tm_joystick._hatSwitchValues[index]);             \
+  else                                                                                        \
+    report->hat[(index) / 2] |= (uint8_t)(hatDirection(tm_joystick._hatSwitchValues[index]) << 4);
+  TM_JOYSTICK_HATS(_FILL_HAT)
+#undef _FILL_HAT
 
   // Set Axis Values
-  buildAndSetAxisValue(tm_joystick._xAxis, 0, 65535, report->x);
-  buildAndSetAxisValue(tm_joystick._yAxis, 0, 65535, report->y);
-  buildAndSetAxisValue(tm_joystick._zAxis, 0, 4095, report->z);
-  buildAndSetAxisValue(tm_joystick._slider, 0, 4095, report->s);
-  
+#define _FILL_AXIS(name, page, usage, bits, in_min, in_max)                       \
+  putAxisValue(&_axisScales[TM_JOYSTICK_AXIS_##name], &_axisShapes[TM_JOYSTICK_AXIS_##name], \
+               tm_joystick._axisValues[TM_JOYSTICK_AXIS_##name], report->name, bits);
+  TM_JOYSTICK_AXES(_FILL_AXIS)
+#undef _FILL_AXIS
+}
+
+void tm_joystick_report_queued(void)
+{
+  button_events_commit(_reportButtonEvents);
+  _reportButtonEvents = 0;
 }
@@ -30,52 +30,32 @@ extern "C"
 {
 #endif
 
-// Joystick Report Descriptor Template
-// with 32 buttons, 4 joysticks and 2 hat/dpad with following layout
-// | Button Map (4 bytes) | hat/DPAD (1 byte) | X | Y | Z | Slider (2 byte each) |
-#define TUD_HID_REPORT_DESC_JOYSTICK(...)                                                      \
-  HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                      \
-      HID_USAGE(HID_USAGE_DESKTOP_JOYSTICK),                                                   \
-      HID_COLLECTION(HID_COLLECTION_APPLICATION), /* Report ID if any */                       \
-      __VA_ARGS__                                 /* 32 bit Button Map */                      \
-      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),                                                   \
-      HID_USAGE_MIN(1),                                                                        \
-      HID_USAGE_MAX(32),                                                                       \
-      HID_LOGICAL_MIN(0),                                                                      \
-      HID_LOGICAL_MAX(1),                                                                      \
-      HID_REPORT_COUNT(32),                                                                    \
-      HID_REPORT_SIZE(1),                                                                      \
-      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* 8 bit DPad/Hat Button Map  */      \
-      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                  \
-      HID_USAGE(HID_USAGE_DESKTOP_HAT_SWITCH),                                                 \
-      HID_LOGICAL_MIN(0),                                                                      \
-      HID_LOGICAL_MAX(7),                                                                      \
-      HID_PHYSICAL_MIN(0),                                                                     \
-      HID_PHYSICAL_MAX_N(315, 2),                                                              \
-      HID_REPORT_COUNT(1),                                                                     \
-      HID_REPORT_SIZE(4),                                                                      \
-      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* 8 bit DPad/Hat Button Map  */      \
-      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                  \
-      HID_USAGE(HID_USAGE_DESKTOP_HAT_SWITCH),                                                 \
-      HID_LOGICAL_MIN(0),                                                                      \
-      HID_LOGICAL_MAX(7),                                                                      \
-      HID_PHYSICAL_MIN(0),                                                                     \
-      HID_PHYSICAL_MAX_N(315, 2),                                                              \
-      HID_REPORT_COUNT(1),                                                                     \
-      HID_REPORT_SIZE(4),                                                                      \
-      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), /* 16 bit X, Y (min 0, max 65535 ) */ \
-      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),                                                  \
-      HID_USAGE(HID_USAGE_DESKTOP_X),                                                          \
-      HID_USAGE(HID_USAGE_DESKTOP_Y),                                                          \
-      HID_USAGE(HID_USAGE_DESKTOP_Z),                                                          \
-      HID_USAGE(HID_USAGE_DESKTOP_SLIDER),                                                     \
-      HID_LOGICAL_MIN(0x00),                                                                   \
-      HID_LOGICAL_MAX_N(0x0000ffff, 3),                                                        \
-      HID_REPORT_COUNT(4),                                                                     \
-      HID_REPORT_SIZE(16),                                                                     \
-      HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),                                       \
+#include "joystick.h"
+
+// Vendor defined interface with feature reports only, see usb_diagnostics.h for the IDs
+#define TUD_HID_REPORT_DESC_DIAG_FEATURE(report_id, usage) \
+  HID_REPORT_ID(report_id)                                 \
+  HID_USAGE(usage),                                        \
+      HID_FEATURE(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+
+#define TUD_HID_REPORT_DESC_DIAGNOSTICS(payload_size, ...) \
+  HID_USAGE_PAGE_N(HID_USAGE_PAGE_VENDOR, 2),              \
+      HID_USAGE(0x01),                                     \
+      HID_COLLECTION(HID_COLLECTION_APPLICATION),          \
+      HID_LOGICAL_MIN(0x00),                               \
+      HID_LOGICAL_MAX_N(0xff, 2),                          \
+      HID_REPORT_SIZE(8),                                  \
+      HID_REPORT_COUNT(payload_size),                      \
+      __VA_ARGS__                                          \
       HID_COLLECTION_END
 
+  // HID instances in interface order
+  enum
+  {
+    HID_INSTANCE_JOYSTICK,
+    HID_INSTANCE_DIAG
+  };
+
   enum
   {
     REPORT_ID_KEYBOARD = 1,
@@ -85,14 +65,18 @@ extern "C"
     REPORT_ID_COUNT
   };
 
+// Default HID IN endpoint polling interval (1, 2, 4 or 8 ms), persisted settings override it
+#ifndef HID_POLL_INTERVAL_MS
+#define HID_POLL_INTERVAL_MS 1
+#endif
+
 #define JOYSTICK_DEFAULT_REPORT_ID 0x03
-#define JOYSTICK_DEFAULT_BUTTON_COUNT 32
+#define EPNUM_HID 0x81
+#define EPNUM_DIAG 0x82
 #define JOYSTICK_DEFAULT_AXIS_MINIMUM 0
 #define JOYSTICK_DEFAULT_AXIS_MAXIMUM 65535
 #define JOYSTICK_DEFAULT_SIMULATOR_MINIMUM 0
 #define JOYSTICK_DEFAULT_SIMULATOR_MAXIMUM 65535
-#define JOYSTICK_DEFAULT_HATSWITCH_COUNT 2
-#define JOYSTICK_HATSWITCH_COUNT_MAXIMUM 2
 #define JOYSTICK_HATSWITCH_RELEASE -1
 #define JOYSTICK_TYPE_JOYSTICK 0x04
 #define JOYSTICK_TYPE_GAMEPAD 0x05
@@ -105,30 +89,18 @@ extern "C"
 
   typedef struct 
   {
-    // Joystick State
-    int32_t _xAxis;
-    int32_t _yAxis;
-    int32_t _zAxis;
-    int32_t _slider;
-    int16_t _hatSwitchValues[JOYSTICK_HATSWITCH_COUNT_MAXIMUM];
-    uint8_t *_buttonValues;
+    // Joystick State, axes by TM_JOYSTICK_AXIS_* index
+    int32_t _axisValues[TM_JOYSTICK_AXIS_COUNT];
+    int16_t _hatSwitchValues[TM_JOYSTICK_HAT_COUNT];
 
     // Joystick Settings
     bool _autoSendState;
-    uint8_t _buttonCount;
-    uint8_t _buttonValuesArraySize;
-    uint8_t _hatSwitchCount;
   } tm_joystick_t;
 
+  // layout from joystick.h
   typedef struct TU_ATTR_PACKED
   {
-    uint8_t buttons[4];
-    uint8_t hat[1];
-    uint8_t x[2];
-    uint8_t y[2];
-    uint8_t z[2];
-    uint8_t s[2];
-
+    TM_JOYSTICK_REPORT_FIELDS
   } tm_joystick_report;
 
   static tm_joystick_t tm_joystick;
@@ -137,6 +109,9 @@ extern "C"
   int buildAndSetAxisValue(int32_t axisValue, int32_t axisMinimum, int32_t axisMaximum, uint8_t dataLocation[]);
   int buildAndSetSimulationValue(int32_t value, int32_t valueMinimum, int32_t valueMaximum, uint8_t dataLocation[]);
 
+  // Polling interval advertised in the configuration descriptor
+  uint8_t usb_hid_poll_interval_ms(void);
+
   void tm_joystick_setup();
 
   void begin(bool initAutoSendState);
@@ -147,6 +122,7 @@ extern "C"
   void tm_joystick_setYAxis(int32_t value);
   void tm_joystick_setZAxis(int32_t value);
   void tm_joystick_setSliderAxis(int32_t value);
+  void tm_joystick_setAxis(uint8_t axis, int32_t value);
 
   void tm_joystick_setButton(uint8_t button, uint8_t value);
   void tm_joystick_pressButton(uint8_t button);
@@ -154,8 +130,30 @@ extern "C"
 
   void tm_joystick_setHatSwitch(int8_t hatSwitch, int16_t value);
 
+  void tm_joystick_getAxes(int32_t *x, int32_t *y, int32_t *z, int32_t *slider);
+
+  /**
+   * @brief map inFrom - inTo onto the report range, then apply deadzones and curve
+   *
+   * Deadzones and curve are in AXIS_SHAPE_ONE units of the deflection from center, see axis_scale.h.
+   * Takes effect with the next report, call from the core that builds reports.
+   *
+   * @param curve : AXIS_SHAPE_POINTS values, NULL for a linear response
+   */
+  void tm_joystick_configureAxis(uint8_t axis, int32_t inFrom, int32_t inTo, uint16_t deadzoneCenter, uint16_t deadzoneEdge, const uint16_t *curve);
+
+  // whether inFrom - inTo leaves a usable scale for the report field of axis
+  bool tm_joystick_checkAxisRange(uint8_t axis, int32_t inFrom, int32_t inTo);
+
+  // input range of an axis in the layout table of joystick.h
+  void tm_joystick_getAxisRange(uint8_t axis, int32_t *inMin, int32_t *inMax);
+
+  // buttons come from button_events, call tm_joystick_report_queued once the report went out
   void tm_joystick_fill_report(tm_joystick_report *report);
 
+  // the last filled report was queued, its button changes count as reported
+  void tm_joystick_report_queued(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "hardware/clocks.h"
+#include "usb_diagnostics.h"
+#include "profile.h"
+#include "trace.h"
+#include "sof_sync.h"
+#include "hall_sensor.h"
+#include "hid_reporter.h"
+#include "report_cache.h"
+
+static uint8_t _selected_stage;
+
+// dump position, moves forward with every trace data report
+static uint8_t _trace_core;
+static uint32_t _trace_index;
+
+static void put_u16(uint8_t *dst, uint16_t value)
+{
+  dst[0] = (uint8_t)value;
+  dst[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+  put_u16(dst, (uint16_t)value);
+  put_u16(dst + 2, (uint16_t)(value >> 16));
+}
+
+static void put_u64(uint8_t *dst, uint64_t value)
+{
+  put_u32(dst, (uint32_t)value);
+  put_u32(dst + 4, (uint32_t)(value >> 32));
+}
+
+static void profile_report(uint8_t *payload)
+{
+  profile_stats_t stats;
+  profile_get(_selected_stage, &stats);
+
+  payload[1] = _selected_stage;
+  payload[2] = PROFILE_STAGE_COUNT;
+  payload[3] = profile_enabled() ? DIAG_PROFILE_FLAG_ENABLED : 0;
+  strncpy((char *)&payload[4], profile_stage_name(_selected_stage), 4);
+  put_u32(&payload[8], stats.count);
+  put_u32(&payload[12], stats.min_cycles);
+  put_u32(&payload[16], stats.max_cycles);
+  put_u64(&payload[20], stats.total_cycles);
+  put_u32(&payload[28], clock_get_hz(clk_sys));
+}
+
+static void histogram_report(uint8_t *payload)
+{
+  profile_stats_t stats;
+  profile_get(_selected_stage, &stats);
+
+  payload[1] = _selected_stage;
+  payload[2] = PROFILE_HISTOGRAM_BUCKETS;
+  for (uint32_t i = 0; i < PROFILE_HISTOGRAM_BUCKETS; ++i)
+    put_u16(&payload[4 + 2 * i], stats.histogram[i] > 0xffff ? 0xffff : (uint16_t)stats.histogram[i]);
+}
+
+static void trace_report(uint8_t *payload)
+{
+  payload[1] = (trace_enabled() ? DIAG_TRACE_FLAG_ENABLED : 0) |
+               (trace_frozen() ? DIAG_TRACE_FLAG_FROZEN : 0);
+  payload[2] = TRACE_CORES;
+  payload[3] = sizeof(trace_event_t);
+  put_u16(&payload[4], TRACE_RING_EVENTS);
+  put_u32(&payload[8], time_us_32());
+  for (uint8_t core = 0; core < TRACE_CORES; ++core)
+    put_u32(&payload[12 + 4 * core], trace_recorded(core));
+}
+
+static void trace_data_report(uint8_t *payload)
+{
+  trace_event_t events[DIAG_TRACE_EVENTS_PER_REPORT];
+  uint32_t count = 0;
+
+  while (_trace_core < TRACE_CORES)
+  {
+    count = trace_read(_trace_core, _trace_index, events, DIAG_TRACE_EVENTS_PER_REPORT);
+    if (count)
+      break;
+    _trace_core++;
+    _trace_index = 0;
+  }
+
+  payload[1] = _trace_core;
+  payload[2] = (uint8_t)count;
+  put_u32(&payload[3], _trace_index);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    uint8_t *dst = &payload[7 + 8 * i];
+    put_u32(dst, events[i].timestamp_us);
+    dst[4] = events[i].type;
+    dst[5] = events[i].core;
+    put_u16(dst + 6, events[i].payload);
+  }
+  _trace_index += count;
+}
+
+static void latency_report(uint8_t *payload)
+{
+  sof_sync_stats_t sof;
+  hid_reporter_stats_t reporter;
+  sof_sync_get_stats(&sof);
+  hid_reporter_get_stats(&reporter);
+
+  uint8_t flags = sof_sync_locked() ? DIAG_LATENCY_FLAG_LOCKED : 0;
+#if TM_SOF_SYNC
+  flags |= DIAG_LATENCY_FLAG_SOF_SYNC;
+#endif
+  payload[1] = flags;
+  put_u32(&payload[4], sof.frames);
+  put_u32(&payload[8], sof.missed);
+  put_u32(&payload[12], sof.max_latency_us);
+  put_u32(&payload[16], hall_sensor_read_time_us());
+  put_u32(&payload[20], reporter.sample_age_us);
+  put_u32(&payload[24], reporter.min_sample_age_us);
+  put_u32(&payload[28], reporter.max_sample_age_us);
+  put_u32(&payload[32], reporter.avg_sample_age_us);
+  put_u32(&payload[36], reporter.reports_completed);
+  put_u32(&payload[40], reporter.reports_per_second);
+  put_u32(&payload[44], reporter.polls_per_second);
+}
+
+static void host_requests_report(uint8_t *payload)
+{
+  report_cache_stats_t stats;
+  report_cache_get_stats(&stats);
+
+  put_u32(&payload[4], stats.input_hits);
+  put_u32(&payload[8], stats.input_built);
+  put_u32(&payload[12], stats.feature_hits);
+  put_u32(&payload[16], stats.feature_live);
+  put_u32(&payload[20], stats.stalled);
+}
+
+uint16_t usb_diag_get_report(uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen)
+{
+  if (report_type != HID_REPORT_TYPE_FEATURE || reqlen < DIAG_PAYLOAD_SIZE)
+    return 0;
+
+  uint8_t payload[DIAG_PAYLOAD_SIZE] = {DIAG_PROTOCOL_VERSION};
+
+  switch (report_id)
+  {
+  case DIAG_REPORT_PROFILE:
+    profile_report(payload);
+    break;
+  case DIAG_REPORT_HISTOGRAM:
+    histogram_report(payload);
+    break;
+  case DIAG_REPORT_TRACE:
+    trace_report(payload);
+    break;
+  case DIAG_REPORT_TRACE_DATA:
+    trace_data_report(payload);
+    break;
+  case DIAG_REPORT_LATENCY:
+    latency_report(payload);
+    break;
+  case DIAG_REPORT_HOST_REQUESTS:
+    host_requests_report(payload);
+    break;
+  default:
+    return 0; // STALL unknown reports
+  }
+
+  // the whole declared report is returned, unused bytes stay zero
+  memcpy(buffer, payload, DIAG_PAYLOAD_SIZE);
+  return DIAG_PAYLOAD_SIZE;
+}
+
+void usb_diag_set_report(uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize)
+{
+  if (report_type != HID_REPORT_TYPE_FEATURE)
+    return;
+
+  // some stack versions pass the report ID as the first byte
+  if (bufsize > 0 && buffer[0] == report_id && bufsize > DIAG_PAYLOAD_SIZE)
+  {
+    buffer++;
+    bufsize--;
+  }
+
+  switch (report_id)
+  {
+  case DIAG_REPORT_PROFILE:
+    if (bufsize >= 1 && buffer[0] < PROFILE_STAGE_COUNT)
+      _selected_stage = buffer[0];
+    if (bufsize >= 2 && (buffer[1] & DIAG_PROFILE_RESET))
+      profile_reset();
+    break;
+  case DIAG_REPORT_TRACE:
+    if (bufsize < 1)
+      break;
+    _trace_core = 0;
+    _trace_index = 0;
+    trace_freeze(buffer[0] == DIAG_TRACE_FREEZE);
+    break;
+  default:
+    break;
+  }
+}
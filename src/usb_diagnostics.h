@@ -0,0 +1,74 @@
+#ifndef _tmext_usb_diagnostics_h
+#define _tmext_usb_diagnostics_h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "pico/stdlib.h"
+#include "tusb.h"
+
+// Feature reports of the vendor defined HID interface, payloads follow the report ID.
+// Multi byte fields are little endian, byte 0 of every payload is DIAG_PROTOCOL_VERSION.
+// Reports 7 to 9 carry the live configuration, see config_protocol.h.
+#define DIAG_PROTOCOL_VERSION 1
+#define DIAG_PAYLOAD_SIZE 63
+
+  enum
+  {
+    // GET: summary of the selected profile stage
+    //   1 stage, 2 stage count, 3 flags (bit 0 profiling compiled in), 4-7 stage name,
+    //   8 count u32, 12 min cycles u32, 16 max cycles u32, 20 total cycles u64, 28 clk_sys Hz u32
+    // SET: 0 stage to select, 1 bit 0 resets all stages
+    DIAG_REPORT_PROFILE = 1,
+    // GET: log2 histogram of the selected stage
+    //   1 stage, 2 bucket count, 4 one u16 per bucket, saturating
+    DIAG_REPORT_HISTOGRAM = 2,
+    // GET: trace state
+    //   1 flags (bit 0 tracing compiled in, bit 1 frozen), 2 core count, 3 event size,
+    //   4 ring size in events u16, 8 time_us_32 now u32, 12 events recorded per core u32
+    // SET: 0 command, DIAG_TRACE_FREEZE stops recording and rewinds the dump,
+    //   DIAG_TRACE_RESTART empties the rings and records again
+    DIAG_REPORT_TRACE = 3,
+    // GET: next events of a frozen trace, core 0 first, oldest first
+    //   1 core, 2 event count (0 once all are read), 3 index of the first event u32,
+    //   7 events of 8 bytes: time_us_32 u32, type u8, core u8, payload u16
+    DIAG_REPORT_TRACE_DATA = 4,
+    // GET: input latency
+    //   1 flags (bit 0 SOF synchronised reads compiled in, bit 1 frame phase locked),
+    //   4 SOFs seen u32, 8 SOFs missed u32, 12 longest SOF handling delay us u32,
+    //   16 sensor read time us u32, 20 sample age of the last report us u32,
+    //   24 min age u32, 28 max age u32, 32 average age u32, 36 reports completed u32,
+    //   40 reports completed during the last full second u32, 44 IN endpoint polls per second u32
+    DIAG_REPORT_LATENCY = 5,
+    // GET: GET_REPORT requests of the host since boot
+    //   4 input reports answered with the last sent one u32, 8 input reports built before
+    //   the first one was sent u32, 12 feature reports from the cache u32,
+    //   16 diagnostics reports measured on request before this one u32, 20 requests stalled u32
+    DIAG_REPORT_HOST_REQUESTS = 6,
+  };
+
+#define DIAG_PROFILE_FLAG_ENABLED 0x01
+#define DIAG_PROFILE_RESET 0x01
+
+#define DIAG_TRACE_FLAG_ENABLED 0x01
+#define DIAG_TRACE_FLAG_FROZEN 0x02
+#define DIAG_TRACE_RESTART 0
+#define DIAG_TRACE_FREEZE 1
+#define DIAG_TRACE_EVENTS_PER_REPORT 7
+
+#define DIAG_LATENCY_FLAG_SOF_SYNC 0x01
+#define DIAG_LATENCY_FLAG_LOCKED 0x02
+
+  // called from tud_hid_get_report_cb for the diagnostics instance
+  uint16_t usb_diag_get_report(uint8_t report_id, hid_report_type_t report_type, uint8_t *buffer, uint16_t reqlen);
+
+  // called from tud_hid_set_report_cb for the diagnostics instance
+  void usb_diag_set_report(uint8_t report_id, hid_report_type_t report_type, uint8_t const *buffer, uint16_t bufsize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _tmext_usb_diagnostics_h */
@@ -0,0 +1,453 @@
+/*
+ * Live configuration client for the extender, see src/config_protocol.h.
+ *
+ * Talks to the diagnostics HID interface through Linux hidraw. With --loopback the
+ * device side of the protocol runs in this process instead, built from the same
+ * source as the firmware, so the protocol can be exercised without hardware.
+ *
+ * usage: tmconfig [-d /dev/hidrawN | --loopback] [command ...]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/hidraw.h>
+
+#include "config_protocol.h"
+
+#define USB_VID 0xCAFE
+#define REPORT_SIZE (CONFIG_PAYLOAD_SIZE + 1) // report ID and payload
+
+static const char *const display_modes[] = {"joystick", "graph", "profile", "values"};
+static const char *const results[] = {"ok", "protocol version not supported", "payload too short",
+                                      "no such axis", "value out of range", "unknown command"};
+
+typedef struct
+{
+  int fd;                  // hidraw node, -1 in loopback
+  config_state_t loopback; // device side state in loopback
+} device_t;
+
+//--------------------------------------------------------------------+
+// Transport
+//--------------------------------------------------------------------+
+
+// payload of a GET, CONFIG_PAYLOAD_SIZE bytes
+static int get_report(device_t *dev, uint8_t report_id, uint8_t *payload)
+{
+  if (dev->fd < 0)
+    return config_protocol_get_report(&dev->loopback, report_id, payload) ? 0 : -1;
+
+  uint8_t buf[REPORT_SIZE] = {report_id};
+  int n = ioctl(dev->fd, HIDIOCGFEATURE(sizeof(buf)), buf);
+  if (n < 2)
+    return -1;
+  memset(payload, 0, CONFIG_PAYLOAD_SIZE);
+  memcpy(payload, buf + 1, (size_t)n - 1);
+  return payload[0] == CONFIG_PROTOCOL_VERSION ? 0 : -1;
+}
+
+static int set_report(device_t *dev, uint8_t report_id, const uint8_t *payload)
+{
+  if (dev->fd < 0)
+  {
+    config_protocol_set_report(&dev->loopback, report_id, payload, CONFIG_PAYLOAD_SIZE);
+    // what the report task does before the next report
+    const uint8_t pending = config_protocol_take_pending(&dev->loopback);
+    if (pending & CONFIG_PENDING_SAVE)
+      printf("loopback: save requested, nothing is persisted\n");
+    return 0;
+  }
+
+  uint8_t buf[REPORT_SIZE] = {report_id};
+  memcpy(buf + 1, payload, CONFIG_PAYLOAD_SIZE);
+  return ioctl(dev->fd, HIDIOCSFEATURE(sizeof(buf)), buf) < 0 ? -1 : 0;
+}
+
+static int get_status(device_t *dev, config_status_t *status)
+{
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  if (get_report(dev, CONFIG_REPORT_COMMAND, payload) < 0 || !config_get_status(payload, sizeof(payload), status))
+    return -1;
+  return 0;
+}
+
+// SET and check the result the device reports for it
+static int set_checked(device_t *dev, uint8_t report_id, const uint8_t *payload)
+{
+  config_status_t status;
+  if (set_report(dev, report_id, payload) < 0 || get_status(dev, &status) < 0)
+  {
+    fprintf(stderr, "report %u: %s\n", report_id, strerror(errno));
+    return -1;
+  }
+  if (status.result != CONFIG_OK)
+  {
+    fprintf(stderr, "report %u: %s\n", report_id,
+            status.result < sizeof(results) / sizeof(results[0]) ? results[status.result] : "error");
+    return -1;
+  }
+  return 0;
+}
+
+static int command(device_t *dev, config_command_t cmd, uint8_t argument)
+{
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  config_put_command(payload, cmd, argument);
+  return set_checked(dev, CONFIG_REPORT_COMMAND, payload);
+}
+
+static int get_device(device_t *dev, config_values_t *values, uint8_t *display_mode_count)
+{
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  if (get_report(dev, CONFIG_REPORT_DEVICE, payload) < 0 || !config_get_device(payload, sizeof(payload), values))
+    return -1;
+  *display_mode_count = payload[2];
+  return 0;
+}
+
+static int get_axis(device_t *dev, uint8_t index, config_axis_t *axis)
+{
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  uint8_t got;
+  if (command(dev, CONFIG_COMMAND_SELECT_AXIS, index) < 0)
+    return -1;
+  if (get_report(dev, CONFIG_REPORT_AXIS, payload) < 0 || !config_get_axis(payload, sizeof(payload), &got, axis) ||
+      got != index)
+    return -1;
+  return 0;
+}
+
+static int set_axis(device_t *dev, uint8_t index, const config_axis_t *axis)
+{
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  config_put_axis(payload, index, axis);
+  return set_checked(dev, CONFIG_REPORT_AXIS, payload);
+}
+
+//--------------------------------------------------------------------+
+// Device discovery
+//--------------------------------------------------------------------+
+
+// hidraw node of the diagnostics interface, the one with a vendor usage page
+static char *find_device(void)
+{
+  static char path[64];
+  glob_t nodes;
+  char *found = NULL;
+
+  if (glob("/sys/class/hidraw/hidraw*", 0, NULL, &nodes) != 0)
+    return NULL;
+
+  for (size_t i = 0; i < nodes.gl_pathc && !found; ++i)
+  {
+    char name[512], uevent[1024] = {0};
+    unsigned char descriptor[3] = {0};
+    char vid[16];
+    FILE *f;
+
+    snprintf(name, sizeof(name), "%s/device/uevent", nodes.gl_pathv[i]);
+    if (!(f = fopen(name, "r")))
+      continue;
+    size_t n = fread(uevent, 1, sizeof(uevent) - 1, f);
+    fclose(f);
+    uevent[n] = 0;
+
+    snprintf(name, sizeof(name), "%s/device/report_descriptor", nodes.gl_pathv[i]);
+    if (!(f = fopen(name, "rb")))
+      continue;
+    n = fread(descriptor, 1, sizeof(descriptor), f);
+    fclose(f);
+
+    snprintf(vid, sizeof(vid), ":%08X:", USB_VID);
+    if (strcasestr(uevent, vid) && n == 3 && descriptor[0] == 0x06 && descriptor[1] == 0x00 && descriptor[2] == 0xff)
+    {
+      snprintf(path, sizeof(path), "/dev/%s", strrchr(nodes.gl_pathv[i], '/') + 1);
+      found = path;
+    }
+  }
+  globfree(&nodes);
+  return found;
+}
+
+// the firmware defaults of the standard joystick layout
+static void loopback_init(config_state_t *state)
+{
+  static const int32_t ranges[][2] = {{0, 65535}, {0, 65535}, {0, 4095}, {0, 4095}};
+  config_values_t *defaults = &state->defaults;
+
+  memset(state, 0, sizeof(*state));
+  state->display_mode_count = sizeof(display_modes) / sizeof(display_modes[0]);
+  defaults->axis_count = sizeof(ranges) / sizeof(ranges[0]);
+  defaults->poll_interval_ms = 1;
+  defaults->min_report_interval_us = 1000;
+  defaults->filter_shift = 2;
+  for (uint8_t axis = 0; axis < defaults->axis_count; ++axis)
+    config_axis_defaults(&defaults->axes[axis], ranges[axis][0], ranges[axis][1]);
+  state->active = *defaults;
+  state->staged = *defaults;
+}
+
+//--------------------------------------------------------------------+
+// Commands
+//--------------------------------------------------------------------+
+
+static double percent(uint16_t value)
+{
+  return 100.0 * value / CONFIG_CURVE_ONE;
+}
+
+static int to_units(const char *arg, uint16_t *value)
+{
+  char *end;
+  double p = strtod(arg, &end);
+  if (*end || p < 0 || p > 100)
+    return -1;
+  *value = (uint16_t)(p * CONFIG_CURVE_ONE / 100 + 0.5);
+  return 0;
+}
+
+static int show(device_t *dev)
+{
+  config_values_t values;
+  config_status_t status;
+  uint8_t display_mode_count;
+
+  if (get_status(dev, &status) < 0 || get_device(dev, &values, &display_mode_count) < 0)
+    return -1;
+
+  const char *mode = values.display_mode < sizeof(display_modes) / sizeof(display_modes[0])
+                         ? display_modes[values.display_mode]
+                         : "?";
+  printf("staged configuration, %s, %u applied since boot\n",
+         status.flags & CONFIG_STATUS_STAGED ? "not applied yet" : "active", status.generation);
+  printf("report interval %u us, poll interval %u ms, filter shift %u, display %s\n",
+         values.min_report_interval_us, values.poll_interval_ms, values.filter_shift, mode);
+
+  for (uint8_t index = 0; index < values.axis_count; ++index)
+  {
+    config_axis_t axis;
+    if (get_axis(dev, index, &axis) < 0)
+      return -1;
+    printf("axis %u: %d to %d, deadzone %.1f%% center %.1f%% edge, curve", index, axis.in_from, axis.in_to,
+           percent(axis.deadzone_center), percent(axis.deadzone_edge));
+    for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+      printf(" %.1f", percent(axis.curve[i]));
+    printf("\n");
+  }
+  return 0;
+}
+
+static int set_device_field(device_t *dev, const char *field, const char *arg)
+{
+  config_values_t values;
+  uint8_t display_mode_count;
+  char *end;
+  unsigned long value = strtoul(arg, &end, 0);
+
+  if (!strcmp(field, "display"))
+  {
+    for (size_t i = 0; i < sizeof(display_modes) / sizeof(display_modes[0]); ++i)
+    {
+      if (!strcmp(arg, display_modes[i]))
+      {
+        value = i;
+        end = "";
+      }
+    }
+  }
+  if (*end)
+  {
+    fprintf(stderr, "%s: not a number: %s\n", field, arg);
+    return -1;
+  }
+
+  if (get_device(dev, &values, &display_mode_count) < 0)
+    return -1;
+
+  if (!strcmp(field, "rate"))
+    values.min_report_interval_us = (uint32_t)value;
+  else if (!strcmp(field, "poll"))
+    values.poll_interval_ms = (uint8_t)value;
+  else if (!strcmp(field, "filter"))
+    values.filter_shift = (uint8_t)value;
+  else
+    values.display_mode = (uint8_t)value;
+
+  uint8_t payload[CONFIG_PAYLOAD_SIZE];
+  config_put_device(payload, &values, display_mode_count);
+  return set_checked(dev, CONFIG_REPORT_DEVICE, payload);
+}
+
+// axis <n> range|deadzone|curve|expo ..., returns the number of arguments used or -1
+static int axis_command(device_t *dev, int argc, char **argv)
+{
+  config_axis_t axis;
+  char *end;
+
+  if (argc < 3)
+    return -1;
+  unsigned long index = strtoul(argv[1], &end, 0);
+  if (*end || index > 255)
+  {
+    fprintf(stderr, "axis %s: not an axis number\n", argv[1]);
+    return -1;
+  }
+  if (get_axis(dev, (uint8_t)index, &axis) < 0)
+    return -1;
+
+  const char *what = argv[2];
+  int used;
+  if (!strcmp(what, "range") && argc >= 5)
+  {
+    axis.in_from = (int32_t)strtol(argv[3], NULL, 0);
+    axis.in_to = (int32_t)strtol(argv[4], NULL, 0);
+    used = 5;
+  }
+  else if (!strcmp(what, "deadzone") && argc >= 5)
+  {
+    if (to_units(argv[3], &axis.deadzone_center) < 0 || to_units(argv[4], &axis.deadzone_edge) < 0)
+      return -1;
+    used = 5;
+  }
+  else if (!strcmp(what, "curve") && argc >= 3 + CONFIG_CURVE_POINTS)
+  {
+    for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+    {
+      if (to_units(argv[3 + i], &axis.curve[i]) < 0)
+        return -1;
+    }
+    used = 3 + CONFIG_CURVE_POINTS;
+  }
+  else if (!strcmp(what, "expo") && argc >= 4)
+  {
+    // y = (1 - k) x + k x^3, k from 0 (linear) to 100 %
+    uint16_t k;
+    if (to_units(argv[3], &k) < 0)
+      return -1;
+    for (int i = 0; i < CONFIG_CURVE_POINTS; ++i)
+    {
+      const double x = (double)i / (CONFIG_CURVE_POINTS - 1);
+      const double e = (double)k / CONFIG_CURVE_ONE;
+      axis.curve[i] = (uint16_t)(((1 - e) * x + e * x * x * x) * CONFIG_CURVE_ONE + 0.5);
+    }
+    used = 4;
+  }
+  else
+  {
+    fprintf(stderr, "axis: expected range <from> <to>, deadzone <center %%> <edge %%>, "
+                    "curve <%d values in %%> or expo <%%>\n",
+            CONFIG_CURVE_POINTS);
+    return -1;
+  }
+
+  return set_axis(dev, (uint8_t)index, &axis) < 0 ? -1 : used;
+}
+
+static void usage(void)
+{
+  fprintf(stderr,
+          "usage: tmconfig [-d /dev/hidrawN | --loopback] [command ...]\n"
+          "\n"
+          "Commands run in order, changes are staged until apply or save. Without a command: show\n"
+          "  show                                 staged configuration\n"
+          "  rate <us>                            minimum interval between reports\n"
+          "  poll <ms>                            HID poll interval 1, 2, 4 or 8, on the next enumeration\n"
+          "  filter <shift>                       sensor smoothing, 0 is off\n"
+          "  display joystick|graph|profile|values\n"
+          "  axis <n> range <from> <to>           raw values reported as minimum and maximum\n"
+          "  axis <n> deadzone <center %%> <edge %%>\n"
+          "  axis <n> curve <p0> ... <p%d>         response in %% at 0, 1/%d ... full deflection\n"
+          "  axis <n> expo <%%>                    cubic curve, 0 is linear\n"
+          "  apply | revert | save | defaults     defaults only stages, apply or save afterwards\n",
+          CONFIG_CURVE_POINTS - 1, CONFIG_CURVE_POINTS - 1);
+}
+
+int main(int argc, char **argv)
+{
+  device_t dev = {.fd = -1};
+  const char *path = NULL;
+  bool loopback = false;
+  int i = 1;
+
+  for (; i < argc && argv[i][0] == '-'; ++i)
+  {
+    if (!strcmp(argv[i], "--loopback"))
+      loopback = true;
+    else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+      path = argv[++i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (loopback)
+  {
+    loopback_init(&dev.loopback);
+  }
+  else
+  {
+    if (!path)
+      path = find_device();
+    if (!path)
+    {
+      fprintf(stderr, "no diagnostics interface found, pass -d\n");
+      return 1;
+    }
+    dev.fd = open(path, O_RDWR);
+    if (dev.fd < 0)
+    {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return 1;
+    }
+  }
+
+  int rc = 0;
+  if (i == argc)
+    rc = show(&dev);
+
+  while (i < argc && rc == 0)
+  {
+    const char *cmd = argv[i];
+    int used = 1;
+
+    if (!strcmp(cmd, "show"))
+      rc = show(&dev);
+    else if (!strcmp(cmd, "apply"))
+      rc = command(&dev, CONFIG_COMMAND_APPLY, 0);
+    else if (!strcmp(cmd, "revert"))
+      rc = command(&dev, CONFIG_COMMAND_REVERT, 0);
+    else if (!strcmp(cmd, "save"))
+      rc = command(&dev, CONFIG_COMMAND_SAVE, 0);
+    else if (!strcmp(cmd, "defaults"))
+      rc = command(&dev, CONFIG_COMMAND_DEFAULTS, 0);
+    else if ((!strcmp(cmd, "rate") || !strcmp(cmd, "poll") || !strcmp(cmd, "filter") || !strcmp(cmd, "display")) &&
+             i + 1 < argc)
+    {
+      rc = set_device_field(&dev, cmd, argv[i + 1]);
+      used = 2;
+    }
+    else if (!strcmp(cmd, "axis"))
+    {
+      used = axis_command(&dev, argc - i, argv + i);
+      rc = used < 0 ? -1 : 0;
+    }
+    else
+    {
+      usage();
+      rc = -1;
+    }
+    i += used > 0 ? used : 1;
+  }
+
+  if (dev.fd >= 0)
+    close(dev.fd);
+  return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""Dump the in-RAM event trace of the extender and convert it to Chrome trace JSON.
+
+The firmware has to be built with TM_TRACE=ON. The trace is read over the vendor
+defined diagnostics HID interface through Linux hidraw, see src/usb_diagnostics.h
+for the feature reports. Open the output in chrome://tracing or ui.perfetto.dev.
+
+usage: trace_dump.py [-d /dev/hidrawN] [-o trace.json] [--no-restart]
+"""
+
+import argparse
+import fcntl
+import glob
+import json
+import os
+import struct
+import sys
+
+USB_VID = 0xCAFE
+
+REPORT_SIZE = 64  # report ID and DIAG_PAYLOAD_SIZE
+DIAG_PROTOCOL_VERSION = 1
+DIAG_REPORT_TRACE = 3
+DIAG_REPORT_TRACE_DATA = 4
+DIAG_TRACE_FLAG_ENABLED = 0x01
+DIAG_TRACE_RESTART = 0
+DIAG_TRACE_FREEZE = 1
+
+EVENT = struct.Struct("<IBBH")
+
+# trace_type_t
+SAMPLE_ACQUIRED = 1
+SENSOR_INVALID = 2
+REPORT_QUEUED = 3
+REPORT_COMPLETE = 4
+SOF = 5
+FRAME_BEGIN = 6
+FRAME_END = 7
+SENSOR_READ_START = 8
+SAMPLE_AGE = 9
+BUTTON_EVENT = 10
+
+INSTANT_NAMES = {
+    SAMPLE_ACQUIRED: "sample",
+    SENSOR_INVALID: "sensor invalid",
+    SOF: "SOF",
+    SENSOR_READ_START: "read start",
+    SAMPLE_AGE: "sample age us",
+    BUTTON_EVENT: "button",
+}
+
+
+def _ioc(direction, number, size):
+    return (direction << 30) | (size << 16) | (ord("H") << 8) | number
+
+
+def hidiocsfeature(size):
+    return _ioc(3, 0x06, size)
+
+
+def hidiocgfeature(size):
+    return _ioc(3, 0x07, size)
+
+
+def find_device():
+    """hidraw node of the diagnostics interface, the one with a vendor usage page"""
+    for node in sorted(glob.glob("/sys/class/hidraw/hidraw*")):
+        try:
+            with open(os.path.join(node, "device", "uevent")) as f:
+                uevent = f.read()
+            with open(os.path.join(node, "device", "report_descriptor"), "rb") as f:
+                descriptor = f.read()
+        except OSError:
+            continue
+        if ":0000%04X:" % USB_VID not in uevent.upper():
+            continue
+        if descriptor.startswith(b"\x06\x00\xff"):
+            return "/dev/" + os.path.basename(node)
+    return None
+
+
+class Diagnostics:
+    def __init__(self, path):
+        self.fd = os.open(path, os.O_RDWR)
+
+    def close(self):
+        os.close(self.fd)
+
+    def get(self, report_id):
+        buf = bytearray(REPORT_SIZE)
+        buf[0] = report_id
+        n = fcntl.ioctl(self.fd, hidiocgfeature(len(buf)), buf, True)
+        payload = bytes(buf[1:n])
+        if not payload or payload[0] != DIAG_PROTOCOL_VERSION:
+            raise RuntimeError("unsupported diagnostics protocol in report %d" % report_id)
+        return payload
+
+    def set(self, report_id, data):
+        buf = bytearray(REPORT_SIZE)
+        buf[0] = report_id
+        buf[1:1 + len(data)] = data
+        fcntl.ioctl(self.fd, hidiocsfeature(len(buf)), buf, True)
+
+
+def read_trace(diag):
+    """freeze the rings and read every event, returns (now_us, events)"""
+    diag.set(DIAG_REPORT_TRACE, bytes([DIAG_TRACE_FREEZE]))
+    state = diag.get(DIAG_REPORT_TRACE)
+    if not state[1] & DIAG_TRACE_FLAG_ENABLED:
+        raise RuntimeError("firmware was built without TM_TRACE")
+    now_us = struct.unpack_from("<I", state, 8)[0]
+
+    events = []
+    while True:
+        data = diag.get(DIAG_REPORT_TRACE_DATA)
+        count = data[2]
+        if count == 0:
+            break
+        for i in range(count):
+            events.append(EVENT.unpack_from(data, 7 + EVENT.size * i))
+    return now_us, events
+
+
+def to_chrome_trace(now_us, events):
+    """convert (timestamp, type, core, payload) tuples, timestamps may have wrapped"""
+    # age relative to the freeze is unambiguous as long as the trace spans less than 71 minutes
+    ages = [(now_us - e[0]) & 0xFFFFFFFF for e in events]
+    oldest = max(ages, default=0)
+
+    out = []
+    for core in sorted({e[2] for e in events}):
+        out.append({"ph": "M", "name": "thread_name", "pid": 0, "tid": core,
+                    "args": {"name": "core %d" % core}})
+
+    for (_, kind, core, payload), age in sorted(zip(events, ages), key=lambda x: -x[1]):
+        ts = oldest - age
+        common = {"pid": 0, "tid": core, "ts": ts}
+        if kind in INSTANT_NAMES:
+            out.append(dict(common, ph="i", s="t", name=INSTANT_NAMES[kind], args={"payload": payload}))
+        elif kind == FRAME_BEGIN:
+            out.append(dict(common, ph="B", name="display frame", args={"mode": payload}))
+        elif kind == FRAME_END:
+            out.append(dict(common, ph="E", name="display frame"))
+        elif kind in (REPORT_QUEUED, REPORT_COMPLETE):
+            # the n-th queued report is the n-th one the host takes
+            out.append(dict(common, ph="b" if kind == REPORT_QUEUED else "e", cat="usb",
+                            name="HID report", id=payload))
+        else:
+            out.append(dict(common, ph="i", s="t", name="type %d" % kind, args={"payload": payload}))
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-d", "--device", help="hidraw node, found by VID and usage page if omitted")
+    parser.add_argument("-o", "--output", default="trace.json", help="Chrome trace JSON file")
+    parser.add_argument("--no-restart", action="store_true", help="leave the trace frozen after the dump")
+    args = parser.parse_args()
+
+    path = args.device or find_device()
+    if not path:
+        sys.exit("no diagnostics interface found, pass --device")
+
+    diag = Diagnostics(path)
+    try:
+        now_us, events = read_trace(diag)
+        if not args.no_restart:
+            diag.set(DIAG_REPORT_TRACE, bytes([DIAG_TRACE_RESTART]))
+    finally:
+        diag.close()
+
+    with open(args.output, "w") as f:
+        json.dump(to_chrome_trace(now_us, events), f)
+    print("%d events written to %s" % (len(events), args.output))
+
+
+if __name__ == "__main__":
+    main()